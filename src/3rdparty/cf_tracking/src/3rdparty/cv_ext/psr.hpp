@@ -60,6 +60,13 @@
 #define PSR_HPP_
 
 #include <limits>
+#include <cmath>
+#include <opencv2/core/core.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PSR_USE_SSE2
+#endif
 
 template<typename T> inline
 T calcPsr(const cv::Mat &response, const cv::Point2i &maxResponseIdx, const int deletionRange, T& peakValue)
@@ -82,4 +89,236 @@ T calcPsr(const cv::Mat &response, const cv::Point2i &maxResponseIdx, const int
     return static_cast<T>(psrClamped);
 }
 
+// result of analyzeResponse
+template<typename T>
+struct ResponseAnalysis
+{
+    // same value as calcPsr for the peak
+    T psr() const
+    {
+        double mean = sideLobeSum / numberOfElements;
+        double variance = sideLobeSquaredSum / numberOfElements - mean * mean;
+        double std_ = std::sqrt(variance > 0 ? variance : 0);
+        return static_cast<T>((peakValue - mean) / (std_ + std::numeric_limits<T>::epsilon()));
+    }
+
+    T peakValue = 0;
+    cv::Point2i peakIdx;
+    // sum and squared sum of the response values clamped to >= 0;
+    // the deletion window around the peak does not contribute
+    double sideLobeSum = 0;
+    double sideLobeSquaredSum = 0;
+    int numberOfElements = 0;
+    // neighbors of the peak (idx - 1, idx, idx + 1) with wrap around
+    T vNeighbors[3];
+    T hNeighbors[3];
+};
+
+namespace psr_detail
+{
+    // adds the clamped sum and squared sum of p[0..n) and returns its maximum
+    inline float accumulateRow(const float* p, int n, double& sum, double& sumSq)
+    {
+        int i = 0;
+        float rowMax = -std::numeric_limits<float>::max();
+        float rowSum = 0, rowSumSq = 0;
+#ifdef PSR_USE_SSE2
+        __m128 vSum = _mm_setzero_ps(), vSumSq = _mm_setzero_ps();
+        __m128 vMax = _mm_set1_ps(rowMax);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 v = _mm_loadu_ps(p + i);
+            __m128 c = _mm_max_ps(v, zero);
+            vMax = _mm_max_ps(vMax, v);
+            vSum = _mm_add_ps(vSum, c);
+            vSumSq = _mm_add_ps(vSumSq, _mm_mul_ps(c, c));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, vSum);
+        rowSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        _mm_storeu_ps(lanes, vSumSq);
+        rowSumSq = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        _mm_storeu_ps(lanes, vMax);
+        rowMax = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+        for (; i < n; ++i)
+        {
+            float c = std::max(p[i], 0.f);
+            rowMax = std::max(rowMax, p[i]);
+            rowSum += c;
+            rowSumSq += c * c;
+        }
+
+        sum += rowSum;
+        sumSq += rowSumSq;
+        return rowMax;
+    }
+
+    inline double accumulateRow(const double* p, int n, double& sum, double& sumSq)
+    {
+        int i = 0;
+        double rowMax = -std::numeric_limits<double>::max();
+        double rowSum = 0, rowSumSq = 0;
+#ifdef PSR_USE_SSE2
+        __m128d vSum = _mm_setzero_pd(), vSumSq = _mm_setzero_pd();
+        __m128d vMax = _mm_set1_pd(rowMax);
+        const __m128d zero = _mm_setzero_pd();
+
+        for (; i + 2 <= n; i += 2)
+        {
+            __m128d v = _mm_loadu_pd(p + i);
+            __m128d c = _mm_max_pd(v, zero);
+            vMax = _mm_max_pd(vMax, v);
+            vSum = _mm_add_pd(vSum, c);
+            vSumSq = _mm_add_pd(vSumSq, _mm_mul_pd(c, c));
+        }
+
+        double lanes[2];
+        _mm_storeu_pd(lanes, vSum);
+        rowSum = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, vSumSq);
+        rowSumSq = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, vMax);
+        rowMax = std::max(lanes[0], lanes[1]);
+#endif
+        for (; i < n; ++i)
+        {
+            double c = std::max(p[i], 0.0);
+            rowMax = std::max(rowMax, p[i]);
+            rowSum += c;
+            rowSumSq += c * c;
+        }
+
+        sum += rowSum;
+        sumSq += rowSumSq;
+        return rowMax;
+    }
+}
+
+// Single pass replacement for minMaxLoc, calcPsr and the neighbor lookup
+// of subPixelDelta. The clamped sums are accumulated over the whole response
+// and the (2 * deletionRange + 1)^2 window around the peak is subtracted
+// afterwards. The window is clipped at the borders of the response circularly
+// shifted by origin (dst(y + origin.y, x + origin.x) = src(y, x)), so the
+// result equals calcPsr on the shifted response without shifting it;
+// use (0, 0) to clip at the borders of the response itself.
+template<typename T> inline
+void analyzeResponse(const cv::Mat& response, const int deletionRange,
+    const cv::Point2i& origin, ResponseAnalysis<T>& result)
+{
+    CV_Assert(response.channels() == 1 && response.depth() == cv::DataType<T>::depth);
+    CV_Assert(!response.empty());
+
+    const int rows = response.rows;
+    const int cols = response.cols;
+    double sum = 0, sumSq = 0;
+    T peakValue = -std::numeric_limits<T>::max();
+    int peakRow = 0;
+
+    for (int row = 0; row < rows; ++row)
+    {
+        T rowMax = psr_detail::accumulateRow(response.ptr<T>(row), cols, sum, sumSq);
+
+        // the first maximum wins like in minMaxLoc
+        if (rowMax > peakValue || row == 0)
+        {
+            peakValue = rowMax;
+            peakRow = row;
+        }
+    }
+
+    // only the row of the peak is scanned again
+    const T* peakRowPtr = response.ptr<T>(peakRow);
+    int peakCol = 0;
+
+    while (peakCol < cols - 1 && peakRowPtr[peakCol] != peakValue)
+        ++peakCol;
+
+    // peak in the shifted response
+    const int shiftedRow = ((peakRow + origin.y) % rows + rows) % rows;
+    const int shiftedCol = ((peakCol + origin.x) % cols + cols) % cols;
+    int deleted = 0;
+
+    for (int sy = shiftedRow - deletionRange; sy <= shiftedRow + deletionRange; ++sy)
+    {
+        if (sy < 0 || sy >= rows)
+            continue;
+
+        const T* rowPtr = response.ptr<T>(((sy - origin.y) % rows + rows) % rows);
+
+        for (int sx = shiftedCol - deletionRange; sx <= shiftedCol + deletionRange; ++sx)
+        {
+            if (sx < 0 || sx >= cols)
+                continue;
+
+            int x = ((sx - origin.x) % cols + cols) % cols;
+            double c = std::max(static_cast<double>(rowPtr[x]), 0.0);
+            sum -= c;
+            sumSq -= c * c;
+            ++deleted;
+        }
+    }
+
+    // avoid rounding residuals if nothing is left
+    if (deleted == rows * cols)
+    {
+        sum = 0;
+        sumSq = 0;
+    }
+
+    for (int i = -1; i < 2; ++i)
+    {
+        result.vNeighbors[i + 1] = response.at<T>(((peakRow + i) % rows + rows) % rows, peakCol);
+        result.hNeighbors[i + 1] = peakRowPtr[((peakCol + i) % cols + cols) % cols];
+    }
+
+    result.peakValue = peakValue;
+    result.peakIdx = cv::Point2i(peakCol, peakRow);
+    result.sideLobeSum = sum;
+    result.sideLobeSquaredSum = sumSq;
+    result.numberOfElements = rows * cols;
+}
+
+// Replaces the side lobe statistics of result (from analyzeResponse) by
+// those of the response sampled every stride elements on the lattice through
+// the peak; this evaluates the PSR of an interpolated response at the
+// resolution it was interpolated from. The deletion range is given in
+// lattice elements and the window is clipped at the lattice borders.
+template<typename T> inline
+void latticeSideLobe(const cv::Mat& response, const int stride,
+    const int deletionRange, ResponseAnalysis<T>& result)
+{
+    CV_Assert(stride > 0);
+
+    const int peakRow = result.peakIdx.y / stride;
+    const int peakCol = result.peakIdx.x / stride;
+    double sum = 0, sumSq = 0;
+    int count = 0;
+
+    for (int ly = 0, y = result.peakIdx.y % stride; y < response.rows; ++ly, y += stride)
+    {
+        const T* rowPtr = response.ptr<T>(y);
+        const bool inWindowRows = std::abs(ly - peakRow) <= deletionRange;
+
+        for (int lx = 0, x = result.peakIdx.x % stride; x < response.cols; ++lx, x += stride)
+        {
+            ++count;
+
+            if (inWindowRows && std::abs(lx - peakCol) <= deletionRange)
+                continue;
+
+            double c = std::max(static_cast<double>(rowPtr[x]), 0.0);
+            sum += c;
+            sumSq += c * c;
+        }
+    }
+
+    result.sideLobeSum = sum;
+    result.sideLobeSquaredSum = sumSq;
+    result.numberOfElements = count;
+}
+
 #endif
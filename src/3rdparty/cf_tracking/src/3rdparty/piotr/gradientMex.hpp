@@ -31,10 +31,14 @@
 * OpenCV interface to Piotr's Computer Vision Matlab Toolbox' FHOG implementation:
 https://github.com/pdollar/toolbox/blob/612f9a0451a6abbe2a64768c9e6654692929102e/channels/private/gradientMex.cpp
 
+Row major (interleaved) images are handled natively by cvFhogRowMajor and
+fhogToColRowMajor: the gradients are computed directly on the interleaved
+image and the histogram cells are written in the row major planar layout
+of FeatureChannels. The col major versions cvFhog and fhogToCol are not
+used by the trackers; they are kept as the baseline of the fhog benchmark
+in src/opentld/benchmark/CFBenchmark.cpp.
+
 TODO:
-* Rewrite fhog col major (clustered) calculation to row major (interleaved) calculation
-** Calculating FHOG on an implicitly transposed image is possible as well (see cvFhogT),
--- but Performance is slightly lower for an unknown reason.
 * Remove code duplication
 * Fix hackfixes properly
 
@@ -56,6 +60,181 @@ namespace piotr {
     void gradMag(float * const I, float * const M,
         float * const O, int h, int w, int d, bool full);
 
+    void gradMagRowMajor(const float * const I, float * const M,
+        float * const O, int h, int w, int d, bool full);
+
+    void gradHist(float * const M, float * const O, float * const H, int h, int w,
+        int bin, int nOrients, int softBin, bool full);
+
+    // fhog() is symmetric in x and y except for the order of the
+    // two mixed energy channels; when it is fed row major gradients
+    // with h and w swapped these two channels are swapped in H
+    inline int rowMajorFhogChannel(int channel)
+    {
+        if (channel == 28)
+            return 29;
+        else if (channel == 29)
+            return 28;
+
+        return channel;
+    }
+
+    // gradient magnitude and orientation of a row major float image
+    inline void gradMagRowMajor(const cv::Mat& img, cv::Mat& magnitude, cv::Mat& orientation)
+    {
+        // ensure array is continuous
+        const cv::Mat& image = (img.isContinuous() ? img : img.clone());
+        int channels = image.channels();
+
+        CV_Assert(channels == 1 || channels == 3);
+        CV_Assert(image.depth() == CV_32F);
+
+        magnitude.create(image.rows, image.cols, CV_32FC1);
+        orientation.create(image.rows, image.cols, CV_32FC1);
+
+        gradMagRowMajor(reinterpret_cast<const float*>(image.data),
+            reinterpret_cast<float*>(magnitude.data),
+            reinterpret_cast<float*>(orientation.data),
+            image.rows, image.cols, channels, true);
+    }
+
+    // fhog cells from row major gradients; the result holds all 32
+    // channels in row major planar layout stacked on top of each other
+    inline cv::Mat fhogCellsRowMajor(const cv::Mat& magnitude, const cv::Mat& orientation,
+        int binSize, bool calcEnergy = true)
+    {
+        const int orientations = 9;
+        const int computeChannels = 32;
+        int widthBin = magnitude.cols / binSize;
+        int heightBin = magnitude.rows / binSize;
+
+        CV_Assert(magnitude.isContinuous() && orientation.isContinuous());
+
+        cv::Mat_<float> cells(heightBin * computeChannels, widthBin, 0.f);
+
+        // fhog() sees the row major data as a
+        // col major image with width and height switched
+        fhog(reinterpret_cast<float*>(magnitude.data),
+            reinterpret_cast<float*>(orientation.data),
+            reinterpret_cast<float*>(cells.data),
+            magnitude.cols, magnitude.rows, binSize, orientations, -1, 0.2f, calcEnergy);
+
+        return cells;
+    }
+
+    // unnormalized histograms of nOrients gradient orientations per cell
+    // of a row major float image; orientations are contrast sensitive if
+    // full is set; the result holds the histograms in row major planar
+    // layout stacked on top of each other
+    inline cv::Mat gradHistRowMajor(const cv::Mat& img, int binSize, int nOrients, bool full)
+    {
+        // ensure array is continuous
+        const cv::Mat& image = (img.isContinuous() ? img : img.clone());
+        int channels = image.channels();
+        CV_Assert(channels == 1 || channels == 3);
+        CV_Assert(image.depth() == CV_32F);
+
+        cv::Mat magnitude(image.rows, image.cols, CV_32FC1);
+        cv::Mat orientation(image.rows, image.cols, CV_32FC1);
+        gradMagRowMajor(reinterpret_cast<const float*>(image.data),
+            reinterpret_cast<float*>(magnitude.data),
+            reinterpret_cast<float*>(orientation.data),
+            image.rows, image.cols, channels, full);
+
+        int widthBin = image.cols / binSize;
+        int heightBin = image.rows / binSize;
+
+        // one additional row; see the hackfix in fhog()
+        cv::Mat_<float> hist(heightBin * nOrients + 1, widthBin, 0.f);
+
+        // gradHist() sees the row major data as a
+        // col major image with width and height switched
+        gradHist(reinterpret_cast<float*>(magnitude.data),
+            reinterpret_cast<float*>(orientation.data),
+            reinterpret_cast<float*>(hist.data),
+            image.cols, image.rows, binSize, nOrients, -1, full);
+
+        return hist.rowRange(0, heightBin * nOrients);
+    }
+
+    // the channels are multiplied by window while they are
+    // written if it is set; window has to be of PRIMITIVE_TYPE
+    template<typename PRIMITIVE_TYPE, class OUT>
+    void fhogCellsToChannels(const cv::Mat& cells, std::shared_ptr<OUT>& cvFeatures,
+        int fhogChannelsToCopy, const cv::Mat& window = cv::Mat())
+    {
+        const int computeChannels = 32;
+        int heightBin = cells.rows / computeChannels;
+
+        // only copy the amount of the channels the user wants
+        // or the amount that fits into the output array
+        int channelsToCopy = std::min(fhogChannelsToCopy, OUT::numberOfChannels());
+
+        for (int c = 0; c < channelsToCopy; ++c)
+        {
+            int hc = rowMajorFhogChannel(c);
+            cv::Mat plane = cells.rowRange(hc * heightBin, (hc + 1) * heightBin);
+
+            // the layout already matches; float channels are
+            // views into the cells, others only change precision
+            if (window.empty())
+            {
+                if (cv::DataType<PRIMITIVE_TYPE>::depth == CV_32F)
+                    cvFeatures->channels[c] = plane;
+                else
+                    plane.convertTo(cvFeatures->channels[c], cv::DataType<PRIMITIVE_TYPE>::type);
+            }
+            else if (cv::DataType<PRIMITIVE_TYPE>::depth == CV_32F)
+            {
+                cv::multiply(plane, window, cvFeatures->channels[c]);
+            }
+            else
+            {
+                plane.convertTo(cvFeatures->channels[c], cv::DataType<PRIMITIVE_TYPE>::type);
+                cv::multiply(cvFeatures->channels[c], window, cvFeatures->channels[c]);
+            }
+        }
+    }
+
+    template<typename PRIMITIVE_TYPE>
+    void fhogCellsToCol(const cv::Mat& cells, cv::Mat& cvFeatures,
+        int colIdx, PRIMITIVE_TYPE cosFactor)
+    {
+        CV_Assert(cvFeatures.channels() == 1 && cvFeatures.isContinuous());
+        CV_Assert(cvFeatures.rows <= cells.rows * cells.cols);
+
+        // the order of rows in cvFeatures does not matter
+        // as long as it is the same for all columns;
+        // zero channel is not copied as it is the last
+        // channel in the cells and cvFeatures rows doesn't include it
+        const float* H = reinterpret_cast<const float*>(cells.data);
+        PRIMITIVE_TYPE* cdata = reinterpret_cast<PRIMITIVE_TYPE*>(cvFeatures.data);
+        int outputWidth = cvFeatures.cols;
+
+        for (int row = 0; row < cvFeatures.rows; ++row)
+            cdata[outputWidth*row + colIdx] = H[row] * cosFactor;
+    }
+
+    template<typename PRIMITIVE_TYPE>
+    void fhogToColRowMajor(const cv::Mat& img, cv::Mat& cvFeatures,
+        int binSize, int colIdx, PRIMITIVE_TYPE cosFactor)
+    {
+        cv::Mat magnitude, orientation;
+        gradMagRowMajor(img, magnitude, orientation);
+        fhogCellsToCol(fhogCellsRowMajor(magnitude, orientation, binSize),
+            cvFeatures, colIdx, cosFactor);
+    }
+
+    template<typename PRIMITIVE_TYPE, class OUT>
+    void cvFhogRowMajor(const cv::Mat& img, std::shared_ptr<OUT>& cvFeatures, int binSize, int fhogChannelsToCopy = 31,
+        const cv::Mat& window = cv::Mat())
+    {
+        cv::Mat magnitude, orientation;
+        gradMagRowMajor(img, magnitude, orientation);
+        cv::Mat cells = fhogCellsRowMajor(magnitude, orientation, binSize, fhogChannelsToCopy != 27);
+        fhogCellsToChannels<PRIMITIVE_TYPE, OUT>(cells, cvFeatures, fhogChannelsToCopy, window);
+    }
+
     template<typename PRIMITIVE_TYPE>
     void fhogToCol(const cv::Mat& img, cv::Mat& cvFeatures,
         int binSize, int colIdx, PRIMITIVE_TYPE cosFactor)
@@ -119,6 +298,7 @@ namespace piotr {
         wrFree(I);
     }
 
+
     template<typename PRIMITIVE_TYPE>
     void fhogToCvColT(const cv::Mat& img, cv::Mat& cvFeatures,
         int binSize, int colIdx, PRIMITIVE_TYPE cosFactor)
@@ -259,7 +439,8 @@ namespace piotr {
     }
 
     template<typename PRIMITIVE_TYPE, class OUT>
-    void cvFhogT(const cv::Mat& img, std::shared_ptr<OUT>& cvFeatures, int binSize, int fhogChannelsToCopy = 31)
+    void cvFhogT(const cv::Mat& img, std::shared_ptr<OUT>& cvFeatures, int binSize, int fhogChannelsToCopy = 31,
+        const cv::Mat& window = cv::Mat())
     {
         const int orientations = 9;
         // ensure array is continuous
@@ -318,14 +499,31 @@ namespace piotr {
         }
 
         PRIMITIVE_TYPE* cdata = 0;
+        const PRIMITIVE_TYPE* wdata = 0;
+
+        if (!window.empty())
+        {
+            CV_Assert(window.type() == cv::DataType<PRIMITIVE_TYPE>::type && window.isContinuous());
+            CV_Assert(window.rows == heightBin && window.cols == widthBin);
+            wdata = reinterpret_cast<const PRIMITIVE_TYPE*>(window.data);
+        }
+
         // implicit transpose on every channel due to col-major to row-major matrix
         for (int c = 0; c < channelsToCopy; ++c)
         {
             float* Hc = H + widthBin * heightBin * c;
             cdata = reinterpret_cast<PRIMITIVE_TYPE*>(cvFeatures->channels[c].data);
 
-            for (int i = 0; i < heightBin * widthBin; ++i)
-                cdata[i] = Hc[i];
+            if (wdata)
+            {
+                for (int i = 0; i < heightBin * widthBin; ++i)
+                    cdata[i] = Hc[i] * wdata[i];
+            }
+            else
+            {
+                for (int i = 0; i < heightBin * widthBin; ++i)
+                    cdata[i] = Hc[i];
+            }
         }
 
         wrFree(M);
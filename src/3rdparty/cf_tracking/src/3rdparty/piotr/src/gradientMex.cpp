@@ -108,15 +108,9 @@ namespace piotr {
     }
 
     // build lookup table a[] s.t. a[x*n]~=acos(x) for x in [-1,1]
-    // TODO: check thread safety of statics!!!!
-    float* acosTable() {
-        const int n = 10000, b = 10; int i;
-        static float a[n * 2 + b * 2];
-        static bool init = false;
-
+    static float* initAcosTable(float* a, const int n, const int b) {
+        int i;
         float *a1 = a + n + b;
-        if (init)
-            return a1;
         for (i = -n - b; i < -n; i++)
             a1[i] = PI;
         for (i = -n; i < n; i++)
@@ -126,11 +120,19 @@ namespace piotr {
         for (i = -n - b; i<n / 10; i++)
             if (a1[i] > PI - 1e-6f)
                 a1[i] = PI - 1e-6f;
-        init = true;
 
         return a1;
     }
 
+    // the table is built once; initialization of function local
+    // statics is thread safe since C++11 (gradMag may run in parallel)
+    float* acosTable() {
+        const int n = 10000, b = 10;
+        static float a[n * 2 + b * 2];
+        static float* const a1 = initAcosTable(a, n, b);
+        return a1;
+    }
+
     // compute gradient magnitude and orientation at each location (uses sse)
     void gradMag(float * const I, float * const M, float * const O,
         int h, int w, int d, bool full)
@@ -216,6 +218,126 @@ namespace piotr {
         alFree(M2);
     }
 
+    // compute gradient magnitude and orientation at each location of a
+    // row major (interleaved) image; M and O are row major as well (uses sse)
+    void gradMagRowMajor(const float * const I, float * const M, float * const O,
+        int h, int w, int d, bool full)
+    {
+        int x, x1, y, i, c, w4, s;
+        __m128 *_Gx, *_Gy, *_M2, _m, _r;
+        float *acost = acosTable(), acMult = 10000.0f;
+        const int n = w * d;
+        // allocate memory for storing one interleaved row of gradients
+        // and one row per channel (padded so w4%4==0)
+        const int n4 = (n % 4 == 0) ? n : n - (n % 4) + 4;
+        w4 = (w % 4 == 0) ? w : w - (w % 4) + 4;
+        s = d*w4*sizeof(float);
+        float * const GxI = (float*)alMalloc(n4*sizeof(float), 16);
+        float * const GyI = (float*)alMalloc(n4*sizeof(float), 16);
+        float * const M2 = (float*)alMalloc(s, 16);
+        _M2 = (__m128*) M2;
+        float * const Gx = (float*)alMalloc(s, 16);
+        _Gx = (__m128*) Gx;
+        float * const Gy = (float*)alMalloc(s, 16);
+        _Gy = (__m128*) Gy;
+        memset(Gx, 0, s);
+        memset(Gy, 0, s);
+
+        // compute gradient magnitude and orientation for each row
+        for (y = 0; y < h; y++)
+        {
+            const float *Ir = I + y*n;
+            const float *Ip = (y == 0) ? Ir : Ir - n;
+            const float *In = (y == h - 1) ? Ir : Ir + n;
+            const float ry = (y == 0 || y == h - 1) ? 1.f : .5f;
+
+            // gradients of all channels at once on the interleaved row
+            _r = SET(ry);
+            for (i = 0; i <= n - 4; i += 4)
+                STR(GyI[i], MUL(SUB(LDu(In[i]), LDu(Ip[i])), _r));
+            for (; i < n; i++)
+                GyI[i] = (In[i] - Ip[i])*ry;
+
+            if (w > 1)
+            {
+                _r = SET(.5f);
+                for (i = d; i <= n - d - 4; i += 4)
+                    STRu(GxI[i], MUL(SUB(LDu(Ir[i + d]), LDu(Ir[i - d])), _r));
+                for (; i < n - d; i++)
+                    GxI[i] = (Ir[i + d] - Ir[i - d])*.5f;
+                for (c = 0; c < d; c++)
+                {
+                    GxI[c] = Ir[d + c] - Ir[c];
+                    GxI[n - d + c] = Ir[n - d + c] - Ir[n - 2 * d + c];
+                }
+            }
+            else
+            {
+                memset(GxI, 0, n*sizeof(float));
+            }
+
+            // split the interleaved gradients into one row per channel and
+            // keep the gradients (Gx, Gy) with maximum squared magnitude (M2);
+            // channels are visited in the same order as the col major
+            // version (red first) so ties are resolved identically
+            for (c = 0; c < d; c++)
+            {
+                const int k = d - 1 - c;
+                float * const gx = Gx + c*w4, * const gy = Gy + c*w4;
+
+                for (x = 0; x < w; x++)
+                {
+                    gx[x] = GxI[x*d + k];
+                    gy[x] = GyI[x*d + k];
+                }
+
+                for (x = 0; x < w4 / 4; x++)
+                {
+                    x1 = w4 / 4 * c + x;
+                    _M2[x1] = ADD(MUL(_Gx[x1], _Gx[x1]), MUL(_Gy[x1], _Gy[x1]));
+                    if (c == 0)
+                        continue;
+                    _m = CMPGT(_M2[x1], _M2[x]);
+                    _M2[x] = OR(AND(_m, _M2[x1]), ANDNOT(_m, _M2[x]));
+                    _Gx[x] = OR(AND(_m, _Gx[x1]), ANDNOT(_m, _Gx[x]));
+                    _Gy[x] = OR(AND(_m, _Gy[x1]), ANDNOT(_m, _Gy[x]));
+                }
+            }
+
+            // compute gradient mangitude (M) and normalize Gx
+            for (x = 0; x < w4 / 4; x++)
+            {
+                _m = MAX_SSE(SQRT(_M2[x]), SET(1e-7f));
+                _M2[x] = _m;
+                if (O) _Gx[x] = MUL(DIV(_Gx[x], _m), SET(acMult));
+                if (O) _Gx[x] = XOR(_Gx[x], AND(_Gy[x], SET(-0.f)));
+            }
+
+            memcpy(M + y*w, M2, w*sizeof(float));
+
+            // compute and store gradient orientation (O) via table lookup
+            if (O != 0)
+            {
+                float * const Or = O + y*w;
+
+                for (x = 0; x < w; x++)
+                    Or[x] = acost[(int)Gx[x]];
+
+                if (full)
+                {
+                    for (x = 0; x < w; x++)
+                        Or[x] += (Gy[x] < 0)*PI;
+                }
+            }
+        }
+
+        alFree(GxI);
+        alFree(GyI);
+        alFree(Gx);
+        alFree(Gy);
+        alFree(M2);
+    }
+
     // normalize gradient magnitude at each location (uses sse)
     void gradMagNorm(float *M, float *S, int h, int w, float norm) {
         __m128 *_M, *_S, _norm; int i = 0, n = h*w, n4 = n / 4;
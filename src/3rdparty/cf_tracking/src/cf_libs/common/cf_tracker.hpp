@@ -56,6 +56,11 @@ namespace cf_tracking
 
         virtual TrackerDebug* getTrackerDebug() = 0;
         virtual const std::string getId() = 0;
+
+        // number of scales searched by the scale filter; 0 if the tracker has none
+        virtual int getNumberOfScales() = 0;
+        // rebuilds the scale filter with numberOfScales scales; it is trained at the next model update
+        virtual void setNumberOfScales(int numberOfScales) = 0;
     };
 }
 #endif
@@ -0,0 +1,240 @@
+/*
+// License Agreement (3-clause BSD License)
+// Copyright (c) 2015, Klaus Haag, all rights reserved.
+// Third party copyrights and patents are property of their respective owners.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the names of the copyright holders nor the names of the contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall copyright holders or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+*/
+
+/*
+The feature cache holds resampled patches of the current frame together
+with their gradient magnitude and orientation and, optionally, their FHOG
+cells. Translation filter and scale estimator extract patches around the
+same position in every frame; patches with identical geometry are only
+resampled and described once. All entries belong to the frame that was
+current when they were inserted and are dropped by newFrame().
+
+The cache is not thread safe. Entries returned by findPatch and
+insertPatch stay valid until they are erased or newFrame() is called,
+so cells of several entries can be computed in parallel with
+computeFhogCells and stored afterwards.
+*/
+
+#ifndef FEATURE_CACHE_HPP_
+#define FEATURE_CACHE_HPP_
+
+#include <map>
+#include "opencv2/core/core.hpp"
+#include "gradientMex.hpp"
+
+namespace cf_tracking
+{
+    struct FeatureCacheKey
+    {
+        // resize type used for patches resized with depResize
+        static const int DEP_RESIZE = -1;
+
+        FeatureCacheKey(const cv::Rect& window_, const cv::Size& size_, int resizeType_)
+            : window(window_), size(size_), resizeType(resizeType_)
+        {}
+
+        bool operator<(const FeatureCacheKey& other) const
+        {
+            if (window.x != other.window.x) return window.x < other.window.x;
+            if (window.y != other.window.y) return window.y < other.window.y;
+            if (window.width != other.window.width) return window.width < other.window.width;
+            if (window.height != other.window.height) return window.height < other.window.height;
+            if (size.width != other.size.width) return size.width < other.size.width;
+            if (size.height != other.size.height) return size.height < other.size.height;
+            return resizeType < other.resizeType;
+        }
+
+        cv::Rect window; // sub window in frame coordinates; see getSubWindowRect
+        cv::Size size; // size the sub window is resized to
+        int resizeType;
+    };
+
+    struct FeatureCacheStats
+    {
+        static double hitRate(unsigned long hits, unsigned long misses)
+        {
+            unsigned long lookups = hits + misses;
+            return (lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups);
+        }
+
+        double patchHitRate() const { return hitRate(patchHits, patchMisses); }
+        double gradientHitRate() const { return hitRate(gradientHits, gradientMisses); }
+        double cellHitRate() const { return hitRate(cellHits, cellMisses); }
+
+        unsigned long patchHits = 0;
+        unsigned long patchMisses = 0;
+        unsigned long gradientHits = 0;
+        unsigned long gradientMisses = 0;
+        unsigned long cellHits = 0;
+        unsigned long cellMisses = 0;
+    };
+
+    class FeatureCache
+    {
+    public:
+        struct Entry
+        {
+            cv::Mat patch; // resized patch; same type as the frame
+            cv::Mat magnitude; // row major gradient magnitude of patch
+            cv::Mat orientation; // row major gradient orientation of patch
+            std::map<int, cv::Mat> cells; // fhog cells; see cellsId
+        };
+
+        FeatureCache(bool cacheFhogCells = true)
+            : _frameIdx(0),
+            _CACHE_FHOG_CELLS(cacheFhogCells)
+        {}
+
+        // drop all entries; has to be called for every new frame
+        void newFrame()
+        {
+            _entries.clear();
+            ++_frameIdx;
+        }
+
+        Entry* findPatch(const FeatureCacheKey& key)
+        {
+            std::map<FeatureCacheKey, Entry>::iterator it = _entries.find(key);
+
+            if (it == _entries.end())
+            {
+                ++_stats.patchMisses;
+                return 0;
+            }
+
+            ++_stats.patchHits;
+            return &it->second;
+        }
+
+        Entry* insertPatch(const FeatureCacheKey& key, const cv::Mat& patch)
+        {
+            Entry& entry = _entries[key];
+            entry = Entry();
+            entry.patch = patch;
+            return &entry;
+        }
+
+        void erasePatch(const FeatureCacheKey& key)
+        {
+            _entries.erase(key);
+        }
+
+        // FHOG cells of a cached patch in the layout of
+        // piotr::fhogCellsRowMajor; gradients are computed on
+        // demand and kept for the rest of the frame
+        cv::Mat getFhogCells(Entry& entry, int binSize, bool calcEnergy = true)
+        {
+            const cv::Mat* cachedCells = findFhogCells(entry, binSize, calcEnergy);
+
+            if (cachedCells)
+                return *cachedCells;
+
+            cv::Mat cells = computeFhogCells(entry, binSize, calcEnergy);
+            storeFhogCells(entry, binSize, calcEnergy, cells);
+            return cells;
+        }
+
+        // returns 0 if the cells have to be computed
+        const cv::Mat* findFhogCells(Entry& entry, int binSize, bool calcEnergy = true)
+        {
+            if (_CACHE_FHOG_CELLS)
+            {
+                std::map<int, cv::Mat>::const_iterator it =
+                    entry.cells.find(cellsId(binSize, calcEnergy));
+
+                if (it != entry.cells.end())
+                {
+                    ++_stats.cellHits;
+                    return &it->second;
+                }
+
+                ++_stats.cellMisses;
+            }
+
+            if (entry.magnitude.empty())
+                ++_stats.gradientMisses;
+            else
+                ++_stats.gradientHits;
+
+            return 0;
+        }
+
+        // only modifies entry; may be called concurrently for
+        // different entries as long as the cache is not modified
+        static cv::Mat computeFhogCells(Entry& entry, int binSize, bool calcEnergy = true)
+        {
+            if (entry.magnitude.empty())
+            {
+                cv::Mat patchFloat;
+                entry.patch.convertTo(patchFloat, CV_32FC(entry.patch.channels()));
+                piotr::gradMagRowMajor(patchFloat, entry.magnitude, entry.orientation);
+            }
+
+            return piotr::fhogCellsRowMajor(entry.magnitude,
+                entry.orientation, binSize, calcEnergy);
+        }
+
+        void storeFhogCells(Entry& entry, int binSize, bool calcEnergy, const cv::Mat& cells)
+        {
+            if (_CACHE_FHOG_CELLS)
+                entry.cells[cellsId(binSize, calcEnergy)] = cells;
+        }
+
+        const FeatureCacheStats& getStats() const
+        {
+            return _stats;
+        }
+
+        void resetStats()
+        {
+            _stats = FeatureCacheStats();
+        }
+
+        int getFrameIdx() const
+        {
+            return _frameIdx;
+        }
+
+    private:
+        static int cellsId(int binSize, bool calcEnergy)
+        {
+            return binSize * 2 + (calcEnergy ? 1 : 0);
+        }
+
+        std::map<FeatureCacheKey, Entry> _entries;
+        FeatureCacheStats _stats;
+        int _frameIdx;
+
+        const bool _CACHE_FHOG_CELLS;
+    };
+}
+
+#endif
@@ -168,6 +168,48 @@ namespace cf_tracking
             return resf;
         }
 
+        // inner products of all pairs of channels
+        static cv::Mat gramFeatures(const std::shared_ptr<FeatureChannels_>& x)
+        {
+            cv::Mat_<T> gram(NUMBER_OF_CHANNELS, NUMBER_OF_CHANNELS);
+
+            for (int i = 0; i < NUMBER_OF_CHANNELS; ++i)
+            {
+                for (int j = i; j < NUMBER_OF_CHANNELS; ++j)
+                {
+                    gram(i, j) = static_cast<T>(x->channels[i].dot(x->channels[j]));
+                    gram(j, i) = gram(i, j);
+                }
+            }
+
+            return gram;
+        }
+
+        // linear combinations of the channels; row i of projection holds
+        // the weights of output channel i; output channels without a
+        // row in projection are set to zero
+        template<class FC>
+        static std::shared_ptr<FC> projectFeatures(const std::shared_ptr<FeatureChannels_>& x,
+            const cv::Mat& projection)
+        {
+            std::shared_ptr<FC> res(new FC());
+
+            for (int i = 0; i < FC::numberOfChannels(); ++i)
+            {
+                res->channels[i] = cv::Mat::zeros(x->channels[0].size(), x->channels[0].type());
+
+                if (i >= projection.rows)
+                    continue;
+
+                const T* weights = projection.ptr<T>(i);
+
+                for (int c = 0; c < NUMBER_OF_CHANNELS; ++c)
+                    cv::scaleAdd(x->channels[c], weights[c], res->channels[i], res->channels[i]);
+            }
+
+            return res;
+        }
+
         static const int numberOfChannels()
         {
             return NUMBER_OF_CHANNELS;
@@ -181,6 +223,10 @@ namespace cf_tracking
 
     template <class T>
     using DsstFeatureChannels = FeatureChannels_ < 28, T > ;
+
+    // channels of N channel features compressed by PCA in the fast DSST mode
+    template <int N, class T>
+    using FastDsstFeatureChannels = FeatureChannels_ < (N < 18 ? N : 18), T > ;
 }
 
 #endif
@@ -0,0 +1,400 @@
+/*
+// License Agreement (3-clause BSD License)
+// Copyright (c) 2015, Klaus Haag, all rights reserved.
+// Third party copyrights and patents are property of their respective owners.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the names of the copyright holders nor the names of the contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall copyright holders or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+*/
+
+/*
+Feature extractors describe a resized template patch by a fixed number of
+channels on a grid of cells. The trackers are templates over the extractor,
+so the number of channels stays a compile time constant of FeatureChannels_.
+
+An extractor FEATURES<T> provides:
+- NUMBER_OF_CHANNELS and the matching FeatureChannels_ type FC
+- a constructor taking FeatureExtractorParameters
+- extract(patch, cellSize, features, window, cache, entry), which computes
+  the channels of floor(patch.rows / cellSize) x floor(patch.cols / cellSize)
+  cells of an 8 bit gray-scale or BGR patch; the channels are multiplied by
+  the window (e.g. the cosine window of a tracker) while they are written
+  if it is not empty; FHOG based extractors may take the cells from the
+  entry of the patch in the feature cache if it is set
+
+FhogFeatureExtractor (31 channels) and DsstFeatureExtractor (28 channels)
+are the default features of the KCF and DSST trackers. The lightweight
+alternatives are GrayFeatureExtractor (1 channel), CompactHogFeatureExtractor
+(10 channels) and ColorNamesFeatureExtractor (10 channels [1]).
+
+References:
+[1] J. van de Weijer, et al.,
+"Learning Color Names for Real-World Applications,"
+in IEEE Trans. on Image Processing, 2009.
+*/
+
+#ifndef FEATURE_EXTRACTORS_HPP_
+#define FEATURE_EXTRACTORS_HPP_
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "feature_channels.hpp"
+#include "feature_cache.hpp"
+#include "gradientMex.hpp"
+
+namespace cf_tracking
+{
+    enum FeatureType
+    {
+        FHOG_FEATURES = 0,
+        GRAY_FEATURES = 1,
+        COMPACT_HOG_FEATURES = 2,
+        COLOR_NAMES_FEATURES = 3
+    };
+
+    struct FeatureExtractorParameters
+    {
+        bool useFhogTranspose = false;
+        int resizeType = cv::INTER_LINEAR;
+
+        // required by ColorNamesFeatureExtractor; see loadColorNamesTable
+        std::shared_ptr<const cv::Mat> colorNamesTable;
+    };
+
+    // gray-scale values in [-0.5, 0.5] averaged over cells
+    template<typename T>
+    cv::Mat grayCells(const cv::Mat& patch, int cellSize)
+    {
+        cv::Mat gray;
+
+        if (patch.channels() == 1)
+            gray = patch;
+        else
+            cvtColor(patch, gray, cv::COLOR_BGR2GRAY);
+
+        if (cellSize != 1)
+        {
+            cv::Size cells(patch.cols / cellSize, patch.rows / cellSize);
+            cv::Mat covered = gray(cv::Rect(0, 0, cells.width * cellSize, cells.height * cellSize));
+            resize(covered, gray, cells, 0, 0, cv::INTER_AREA);
+        }
+
+        cv::Mat res;
+        gray.convertTo(res, cv::DataType<T>::type, 1.0 / 255.0, -0.5);
+        return res;
+    }
+
+    // writes src with the precision of T to channel;
+    // multiplied by window if it is not empty
+    template<typename T>
+    void writeChannel(const cv::Mat& src, cv::Mat& channel, const cv::Mat& window)
+    {
+        if (src.type() == cv::DataType<T>::type)
+        {
+            if (window.empty())
+                channel = src;
+            else
+                cv::multiply(src, window, channel);
+
+            return;
+        }
+
+        src.convertTo(channel, cv::DataType<T>::type);
+
+        if (!window.empty())
+            cv::multiply(channel, window, channel);
+    }
+
+    // loads the color name probabilities of [1] for the 32768 RGB
+    // bins indexed by R / 8 + 32 * (G / 8) + 1024 * (B / 8); the file
+    // holds one row of 11 probabilities per bin, optionally preceded
+    // by the RGB values of the bin (w2c.txt of the original authors);
+    // the probabilities are projected onto the 10 dimensional subspace
+    // orthogonal to their constant sum
+    inline bool loadColorNamesTable(const std::string& fileName, cv::Mat& table)
+    {
+        const int nBins = 32768;
+        const int nNames = 11;
+        std::ifstream file(fileName.c_str());
+
+        if (!file.is_open())
+            return false;
+
+        std::vector<float> values;
+        float value = 0;
+
+        while (file >> value)
+            values.push_back(value);
+
+        if (values.size() != static_cast<size_t>(nBins * nNames)
+            && values.size() != static_cast<size_t>(nBins * (nNames + 3)))
+            return false;
+
+        int rowLength = static_cast<int>(values.size() / nBins);
+        cv::Mat probabilities(nBins, rowLength, CV_32FC1, &values[0]);
+        probabilities = probabilities.colRange(rowLength - nNames, rowLength);
+
+        // orthonormal basis of the subspace orthogonal to (1, ..., 1)
+        cv::Mat_<float> basis(nNames, nNames - 1, 0.f);
+
+        for (int k = 1; k < nNames; ++k)
+        {
+            float norm = static_cast<float>(1.0 / sqrt(k * (k + 1.0)));
+
+            for (int i = 0; i < k; ++i)
+                basis(i, k - 1) = norm;
+
+            basis(k, k - 1) = -k * norm;
+        }
+
+        table = probabilities * basis;
+        return true;
+    }
+
+    template<typename T>
+    class FhogFeatureExtractor
+    {
+    public:
+        static const int NUMBER_OF_CHANNELS = 31;
+        typedef FeatureChannels_<NUMBER_OF_CHANNELS, T> FC;
+
+        explicit FhogFeatureExtractor(const FeatureExtractorParameters& paras)
+        {
+            if (paras.useFhogTranspose)
+                cvFhog = &piotr::cvFhogT < T, FC > ;
+            else
+                cvFhog = &piotr::cvFhogRowMajor < T, FC > ;
+        }
+
+        // the patch is scaled to [0, 1] before the fhog cells are computed;
+        // cached cells are computed from the unscaled patch and not used
+        void extract(const cv::Mat& patch, int cellSize, std::shared_ptr<FC>& features,
+            const cv::Mat& window, FeatureCache* = 0, FeatureCache::Entry* = 0) const
+        {
+            cv::Mat patchFloat;
+            patch.convertTo(patchFloat, CV_32F, 0.003921568627451); // patch / 255
+
+            features.reset(new FC());
+            cvFhog(patchFloat, features, cellSize, NUMBER_OF_CHANNELS, window);
+        }
+
+    private:
+        typedef void(*cvFhogPtr)
+            (const cv::Mat& img, std::shared_ptr<FC>& cvFeatures, int binSize, int fhogChannelsToCopy,
+            const cv::Mat& window);
+        cvFhogPtr cvFhog = 0;
+    };
+
+    // 27 fhog channels without the energy channels and the gray-scale image
+    template<typename T>
+    class DsstFeatureExtractor
+    {
+    public:
+        static const int NUMBER_OF_CHANNELS = 28;
+        typedef FeatureChannels_<NUMBER_OF_CHANNELS, T> FC;
+
+        explicit DsstFeatureExtractor(const FeatureExtractorParameters& paras)
+            : _RESIZE_TYPE(paras.resizeType)
+        {
+            if (paras.useFhogTranspose)
+                cvFhog = &piotr::cvFhogT < T, FC > ;
+            else
+                cvFhog = &piotr::cvFhogRowMajor < T, FC > ;
+        }
+
+        void extract(const cv::Mat& patch, int cellSize, std::shared_ptr<FC>& features,
+            const cv::Mat& window, FeatureCache* cache = 0, FeatureCache::Entry* entry = 0) const
+        {
+            features.reset(new FC());
+
+            if (cache && entry)
+            {
+                // energy channels are not part of FC
+                piotr::fhogCellsToChannels<T, FC>(cache->getFhogCells(*entry, cellSize, false),
+                    features, NUMBER_OF_CHANNELS - 1, window);
+            }
+            else
+            {
+                cv::Mat floatPatch;
+                patch.convertTo(floatPatch, CV_32F);
+                cvFhog(floatPatch, features, cellSize, NUMBER_OF_CHANNELS - 1, window);
+            }
+
+            // append gray-scale image
+            cv::Mat grayPatch = patch;
+
+            if (cellSize != 1)
+                resize(patch, grayPatch, features->channels[0].size(), 0, 0, _RESIZE_TYPE);
+
+            cv::Mat grayFrame = grayPatch;
+
+            if (grayPatch.channels() != 1)
+                cvtColor(grayPatch, grayFrame, cv::COLOR_BGR2GRAY);
+
+            grayFrame.convertTo(grayFrame, cv::DataType<T>::type, 1.0 / 255.0, -0.5);
+            writeChannel<T>(grayFrame, features->channels[NUMBER_OF_CHANNELS - 1], window);
+        }
+
+    private:
+        typedef void(*cvFhogPtr)
+            (const cv::Mat& img, std::shared_ptr<FC>& cvFeatures, int binSize, int fhogChannelsToCopy,
+            const cv::Mat& window);
+        cvFhogPtr cvFhog = 0;
+        const int _RESIZE_TYPE;
+    };
+
+    template<typename T>
+    class GrayFeatureExtractor
+    {
+    public:
+        static const int NUMBER_OF_CHANNELS = 1;
+        typedef FeatureChannels_<NUMBER_OF_CHANNELS, T> FC;
+
+        explicit GrayFeatureExtractor(const FeatureExtractorParameters&)
+        {}
+
+        void extract(const cv::Mat& patch, int cellSize, std::shared_ptr<FC>& features,
+            const cv::Mat& window, FeatureCache* = 0, FeatureCache::Entry* = 0) const
+        {
+            features.reset(new FC());
+            writeChannel<T>(grayCells<T>(patch, cellSize), features->channels[0], window);
+        }
+    };
+
+    // 9 contrast insensitive orientation histograms normalized by the
+    // energy of their cell and the gray-scale image; about a third of the
+    // channels of fhog without its block normalization
+    template<typename T>
+    class CompactHogFeatureExtractor
+    {
+    public:
+        static const int NUMBER_OF_CHANNELS = 10;
+        typedef FeatureChannels_<NUMBER_OF_CHANNELS, T> FC;
+
+        explicit CompactHogFeatureExtractor(const FeatureExtractorParameters&)
+        {}
+
+        void extract(const cv::Mat& patch, int cellSize, std::shared_ptr<FC>& features,
+            const cv::Mat& window, FeatureCache* = 0, FeatureCache::Entry* = 0) const
+        {
+            const int orientations = NUMBER_OF_CHANNELS - 1;
+            cv::Mat patchFloat;
+            patch.convertTo(patchFloat, CV_32FC(patch.channels()));
+
+            cv::Mat hist = piotr::gradHistRowMajor(patchFloat, cellSize, orientations, false);
+            int heightBin = hist.rows / orientations;
+            cv::Mat energy = cv::Mat::zeros(heightBin, hist.cols, CV_32FC1);
+
+            for (int o = 0; o < orientations; ++o)
+            {
+                cv::Mat plane = hist.rowRange(o * heightBin, (o + 1) * heightBin);
+                energy += plane.mul(plane);
+            }
+
+            // the offset suppresses noise in cells without structure
+            sqrt(energy, energy);
+            energy += 0.1 * cv::mean(energy)[0] + 1e-6;
+            features.reset(new FC());
+
+            for (int o = 0; o < orientations; ++o)
+            {
+                cv::Mat plane = hist.rowRange(o * heightBin, (o + 1) * heightBin);
+                cv::Mat normalized = plane / energy;
+                writeChannel<T>(normalized, features->channels[o], window);
+            }
+
+            writeChannel<T>(grayCells<T>(patch, cellSize),
+                features->channels[NUMBER_OF_CHANNELS - 1], window);
+        }
+    };
+
+    // color names [1] averaged over cells
+    template<typename T>
+    class ColorNamesFeatureExtractor
+    {
+    public:
+        static const int NUMBER_OF_CHANNELS = 10;
+        typedef FeatureChannels_<NUMBER_OF_CHANNELS, T> FC;
+
+        explicit ColorNamesFeatureExtractor(const FeatureExtractorParameters& paras)
+            : _table(paras.colorNamesTable)
+        {
+            CV_Assert(_table && _table->rows == 32768 && _table->cols == NUMBER_OF_CHANNELS);
+        }
+
+        void extract(const cv::Mat& patch, int cellSize, std::shared_ptr<FC>& features,
+            const cv::Mat& window, FeatureCache* = 0, FeatureCache::Entry* = 0) const
+        {
+            cv::Mat bgr = patch;
+
+            if (patch.channels() == 1)
+                cvtColor(patch, bgr, cv::COLOR_GRAY2BGR);
+
+            CV_Assert(bgr.type() == CV_8UC3);
+            cv::Size cells(bgr.cols / cellSize, bgr.rows / cellSize);
+            cv::Mat covered = bgr(cv::Rect(0, 0, cells.width * cellSize, cells.height * cellSize));
+            cv::Mat names[NUMBER_OF_CHANNELS];
+
+            for (int c = 0; c < NUMBER_OF_CHANNELS; ++c)
+                names[c].create(covered.size(), CV_32FC1);
+
+            for (int row = 0; row < covered.rows; ++row)
+            {
+                const cv::Vec3b* pixels = covered.ptr<cv::Vec3b>(row);
+
+                for (int col = 0; col < covered.cols; ++col)
+                {
+                    const cv::Vec3b& p = pixels[col];
+                    int bin = (p[2] >> 3) + 32 * (p[1] >> 3) + 1024 * (p[0] >> 3);
+                    const float* values = _table->ptr<float>(bin);
+
+                    for (int c = 0; c < NUMBER_OF_CHANNELS; ++c)
+                        names[c].at<float>(row, col) = values[c];
+                }
+            }
+
+            features.reset(new FC());
+
+            for (int c = 0; c < NUMBER_OF_CHANNELS; ++c)
+            {
+                if (cellSize != 1)
+                    resize(names[c], names[c], cells, 0, 0, cv::INTER_AREA);
+
+                writeChannel<T>(names[c], features->channels[c], window);
+            }
+        }
+
+    private:
+        std::shared_ptr<const cv::Mat> _table;
+    };
+}
+
+#endif
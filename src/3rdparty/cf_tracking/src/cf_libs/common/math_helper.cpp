@@ -64,4 +64,30 @@ namespace cf_tracking
 
         cv::resize(source, dst, dsize, 0, 0, interpolationType);
     }
+
+    // indices and weights of frequency k of an n point spectrum in a
+    // zero padded m point spectrum; the nyquist term of an even n is
+    // split between both ends to keep the padded spectrum symmetric
+    int padFrequency(int k, int n, int m, int* indices, double* weights)
+    {
+        if (2 * k < n)
+        {
+            indices[0] = k;
+            weights[0] = 1;
+            return 1;
+        }
+
+        if (2 * k == n && m > n)
+        {
+            indices[0] = k;
+            indices[1] = m - k;
+            weights[0] = 0.5;
+            weights[1] = 0.5;
+            return 2;
+        }
+
+        indices[0] = k + m - n;
+        weights[0] = 1;
+        return 1;
+    }
 }
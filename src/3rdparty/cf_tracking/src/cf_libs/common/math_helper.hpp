@@ -33,6 +33,11 @@
 #define HELPER_H_
 
 #include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 #include "cv_ext.hpp"
 #include "mat_consts.hpp"
@@ -43,6 +48,7 @@ namespace cf_tracking
     void dftNoCcs(const cv::Mat& input, cv::Mat& out, int flags = 0);
     int mod(int dividend, int divisor);
     void depResize(const cv::Mat& source, cv::Mat& dst, const cv::Size& dsize);
+    int padFrequency(int k, int n, int m, int* indices, double* weights);
 
     template<typename T>
     cv::Size_<T> sizeFloor(cv::Size_<T> size)
@@ -50,6 +56,16 @@ namespace cf_tracking
         return cv::Size_<T>(floor(size.width), floor(size.height));
     }
 
+    // true if scale equals reference up to rounding; a scale that went
+    // through the scale estimator is multiplied and divided by the
+    // template scale factor, so it rarely compares equal exactly; the
+    // tolerance is far below one scale step
+    template<typename T>
+    bool isSameScale(T scale, T reference)
+    {
+        return std::abs(scale - reference) <= static_cast<T>(1e-4) * reference;
+    }
+
     template <typename T>
     cv::Mat numberToRowVector(int n)
     {
@@ -74,7 +90,7 @@ namespace cf_tracking
 
     // http://home.isr.uc.pt/~henriques/circulant/
     template <typename T>
-    T subPixelPeak(T* p)
+    T subPixelPeak(const T* p)
     {
         T delta = mat_consts::constants<T>::c0_5 * (p[2] - p[0]) / (2 * p[1] - p[2] - p[0]);
 
@@ -104,6 +120,15 @@ namespace cf_tracking
         return subDelta;
     }
 
+    // subPixelDelta with the neighbors of the peak already
+    // gathered, e.g. by analyzeResponse
+    template <typename T>
+    cv::Point_<T> subPixelDelta(const cv::Point2i& delta, const T* vNeighbors, const T* hNeighbors)
+    {
+        return cv::Point_<T>(delta.x + subPixelPeak(hNeighbors),
+            delta.y + subPixelPeak(vNeighbors));
+    }
+
     // http://home.isr.uc.pt/~henriques/circulant/
     template <typename T>
     cv::Mat gaussianShapedLabels2D(T sigma, const cv::Size_<T>& size)
@@ -206,6 +231,114 @@ namespace cf_tracking
         return w;
     }
 
+    // real 1 x n kernel k with (x * k)(i) = x(i + shift) for circular
+    // convolution; fractional shifts are band limited interpolations
+    // with a real valued nyquist term for even n
+    template<typename T>
+    cv::Mat circularShiftKernel(int n, T shift)
+    {
+        CV_Assert(n > 0);
+        const double pi = 3.14159265358979323846;
+        cv::Mat_<T> k = cv::Mat_<T>(1, n);
+
+        for (int x = 0; x < n; ++x)
+        {
+            double sum = 0;
+
+            for (int u = 0; u < n; ++u)
+            {
+                if (2 * u == n)
+                {
+                    sum += cos(pi * shift) * cos(pi * x);
+                }
+                else
+                {
+                    int frequency = (2 * u < n ? u : u - n);
+                    sum += cos(2.0 * pi * frequency * (shift + x) / n);
+                }
+            }
+
+            k.template at<T>(0, x) = static_cast<T>(sum / n);
+        }
+
+        return k;
+    }
+
+    // spectrum which circularly shifts a 2D signal of the given size
+    // by shift samples when multiplied with the signal's spectrum;
+    // flags are passed to dft
+    template<typename T>
+    cv::Mat circularShiftSpectrum(const cv::Size& size, const cv::Point_<T>& shift, int flags = 0)
+    {
+        cv::Mat kx = circularShiftKernel<T>(size.width, shift.x);
+        cv::Mat ky = circularShiftKernel<T>(size.height, shift.y);
+        cv::Mat k = ky.t() * kx;
+        cv::Mat kf;
+        dft(k, kf, flags);
+        return kf;
+    }
+
+    // band limited interpolation of a real periodic response to a
+    // larger size by zero padding its spectrum; the sample (y, x) of
+    // the response is found at (y * size.height / response.rows,
+    // x * size.width / response.cols) in the interpolated response
+    template<typename T>
+    void interpolateResponse(const cv::Mat& response, const cv::Size& size, cv::Mat& interpolated)
+    {
+        typedef cv::Vec<T, 2> Complex;
+        CV_Assert(size.width >= response.cols && size.height >= response.rows);
+
+        cv::Mat spectrum;
+        cv::dft(response, spectrum, cv::DFT_COMPLEX_OUTPUT);
+        cv::Mat padded = cv::Mat::zeros(size, spectrum.type());
+        int rowIdx[2], colIdx[2];
+        double rowWeights[2], colWeights[2];
+
+        for (int y = 0; y < spectrum.rows; ++y)
+        {
+            int nRows = padFrequency(y, spectrum.rows, size.height, rowIdx, rowWeights);
+            const Complex* src = spectrum.ptr<Complex>(y);
+
+            for (int x = 0; x < spectrum.cols; ++x)
+            {
+                int nCols = padFrequency(x, spectrum.cols, size.width, colIdx, colWeights);
+
+                for (int i = 0; i < nRows; ++i)
+                {
+                    for (int j = 0; j < nCols; ++j)
+                    {
+                        padded.at<Complex>(rowIdx[i], colIdx[j]) +=
+                            src[x] * static_cast<T>(rowWeights[i] * colWeights[j]);
+                    }
+                }
+            }
+        }
+
+        cv::idft(padded, interpolated, cv::DFT_REAL_OUTPUT);
+        interpolated *= 1.0 / response.total();
+    }
+
+    // principal axes of uncentered samples given their gram matrix;
+    // the axes are returned as rows of basis with decreasing energy in
+    // eigenvalues; at most maxComponents axes are kept and axes without
+    // significant energy are dropped
+    template<typename T>
+    void pcaBasis(const cv::Mat& gram, int maxComponents, cv::Mat& basis, cv::Mat& eigenvalues)
+    {
+        cv::Mat values, vectors;
+        cv::eigen(gram, values, vectors);
+
+        T threshold = values.at<T>(0) * 1000 * std::numeric_limits<T>::epsilon();
+        int nComponents = 0;
+        int maxIdx = std::min(maxComponents, values.rows);
+
+        while (nComponents < maxIdx && values.at<T>(nComponents) > threshold)
+            ++nComponents;
+
+        basis = vectors.rowRange(0, nComponents);
+        eigenvalues = values.rowRange(0, nComponents);
+    }
+
     template <typename T>
     void divideSpectrumsNoCcs(const cv::Mat& numerator, const cv::Mat& denominator, cv::Mat& dst)
     {
@@ -260,16 +393,31 @@ namespace cf_tracking
         }
     }
 
-    // http://home.isr.uc.pt/~henriques/circulant/
+    // sub window of getSubWindow in image coordinates
+    // before clipping and border replication
     template<typename T>
-    bool getSubWindow(const cv::Mat& image, cv::Mat& patch, const cv::Size_<T>& size,
-        const cv::Point_<T>& pos, cv::Point_<T>* posInSubWindow = 0)
+    cv::Rect getSubWindowRect(const cv::Size_<T>& size, const cv::Point_<T>& pos)
     {
         int width = static_cast<int>(size.width);
         int height = static_cast<int>(size.height);
 
         int xs = static_cast<int>(std::floor(pos.x) - std::floor(width / 2.0)) + 1;
         int ys = static_cast<int>(std::floor(pos.y) - std::floor(height / 2.0)) + 1;
+
+        return cv::Rect(xs, ys, width, height);
+    }
+
+    // http://home.isr.uc.pt/~henriques/circulant/
+    template<typename T>
+    bool getSubWindow(const cv::Mat& image, cv::Mat& patch, const cv::Size_<T>& size,
+        const cv::Point_<T>& pos, cv::Point_<T>* posInSubWindow = 0)
+    {
+        cv::Rect window = getSubWindowRect(size, pos);
+        int width = window.width;
+        int height = window.height;
+
+        int xs = window.x;
+        int ys = window.y;
         T posInSubWindowX = pos.x - xs;
         T posInSubWindowY = pos.y - ys;
 
@@ -314,6 +462,148 @@ namespace cf_tracking
 
         return true;
     }
+
+    // getSubWindow followed by a resize to dstSize in a single pass
+    // over the image; the border replication becomes a clamping of the
+    // sample indices and the samples are placed like in cv::resize, so
+    // the result equals the two separate steps up to rounding; patchDepth
+    // is CV_8U or CV_32F (unscaled); interpolations other than
+    // INTER_NEAREST and INTER_LINEAR and images other than 8 bit
+    // fall back to getSubWindow and cv::resize
+    template<typename T>
+    bool sampleSubWindow(const cv::Mat& image, cv::Mat& patch, const cv::Size_<T>& size,
+        const cv::Point_<T>& pos, const cv::Size& dstSize, int interpolation,
+        int patchDepth = CV_8U, cv::Point_<T>* posInSubWindow = 0)
+    {
+        CV_Assert(patchDepth == CV_8U || patchDepth == CV_32F);
+        const int cn = image.channels();
+
+        if (image.depth() != CV_8U
+            || (interpolation != cv::INTER_NEAREST && interpolation != cv::INTER_LINEAR))
+        {
+            cv::Mat subWindow;
+
+            if (getSubWindow(image, subWindow, size, pos, posInSubWindow) == false)
+                return false;
+
+            if (subWindow.size() != dstSize)
+                cv::resize(subWindow, subWindow, dstSize, 0, 0, interpolation);
+
+            subWindow.convertTo(patch, CV_MAKETYPE(patchDepth, cn));
+            return true;
+        }
+
+        cv::Rect window = getSubWindowRect(size, pos);
+        cv::Rect imageRect(0, 0, image.cols, image.rows);
+
+        // same validity as getSubWindow
+        if ((window & imageRect).area() == 0)
+            return false;
+
+        if (posInSubWindow != 0)
+        {
+            posInSubWindow->x = pos.x - window.x;
+            posInSubWindow->y = pos.y - window.y;
+        }
+
+        const bool isLinear = (interpolation == cv::INTER_LINEAR);
+        const float scaleX = static_cast<float>(window.width) / dstSize.width;
+        const float scaleY = static_cast<float>(window.height) / dstSize.height;
+
+        // source element offsets and weights of the right neighbors per column
+        std::vector<int> xOffsets(dstSize.width * 2);
+        std::vector<float> xWeights(dstSize.width);
+
+        for (int x = 0; x < dstSize.width; ++x)
+        {
+            int x0 = 0;
+            float w = 0;
+
+            if (isLinear)
+            {
+                float fx = (x + 0.5f) * scaleX - 0.5f;
+                x0 = cvFloor(fx);
+                w = fx - x0;
+
+                if (x0 < 0)
+                {
+                    x0 = 0;
+                    w = 0;
+                }
+                else if (x0 >= window.width - 1)
+                {
+                    x0 = window.width - 1;
+                    w = 0;
+                }
+            }
+            else
+            {
+                x0 = std::min(cvFloor(x * scaleX), window.width - 1);
+            }
+
+            int x1 = std::min(x0 + 1, window.width - 1);
+            xOffsets[2 * x] = std::min(std::max(window.x + x0, 0), image.cols - 1) * cn;
+            xOffsets[2 * x + 1] = std::min(std::max(window.x + x1, 0), image.cols - 1) * cn;
+            xWeights[x] = w;
+        }
+
+        patch.create(dstSize, CV_MAKETYPE(patchDepth, cn));
+
+        for (int y = 0; y < dstSize.height; ++y)
+        {
+            int y0 = 0;
+            float wy = 0;
+
+            if (isLinear)
+            {
+                float fy = (y + 0.5f) * scaleY - 0.5f;
+                y0 = cvFloor(fy);
+                wy = fy - y0;
+
+                if (y0 < 0)
+                {
+                    y0 = 0;
+                    wy = 0;
+                }
+                else if (y0 >= window.height - 1)
+                {
+                    y0 = window.height - 1;
+                    wy = 0;
+                }
+            }
+            else
+            {
+                y0 = std::min(cvFloor(y * scaleY), window.height - 1);
+            }
+
+            int y1 = std::min(y0 + 1, window.height - 1);
+            const unsigned char* row0 = image.ptr<unsigned char>(std::min(std::max(window.y + y0, 0), image.rows - 1));
+            const unsigned char* row1 = image.ptr<unsigned char>(std::min(std::max(window.y + y1, 0), image.rows - 1));
+            unsigned char* dst8u = patch.ptr<unsigned char>(y);
+            float* dst32f = patch.ptr<float>(y);
+
+            for (int x = 0; x < dstSize.width; ++x)
+            {
+                const int ofs0 = xOffsets[2 * x];
+                const int ofs1 = xOffsets[2 * x + 1];
+                const float wx = xWeights[x];
+
+                for (int c = 0; c < cn; ++c)
+                {
+                    float top = row0[ofs0 + c] + wx * (row0[ofs1 + c] - row0[ofs0 + c]);
+                    float bottom = row1[ofs0 + c] + wx * (row1[ofs1 + c] - row1[ofs0 + c]);
+                    float value = top + wy * (bottom - top);
+
+                    if (patchDepth == CV_8U)
+                        dst8u[x * cn + c] = cv::saturate_cast<unsigned char>(value);
+                    else
+                        dst32f[x * cn + c] = value;
+                }
+            }
+        }
+
+        return true;
+    }
 }
 
 #endif
@@ -41,11 +41,19 @@ Every complex matrix is as default in CCS packed form:
 see : https://software.intel.com/en-us/node/504243
 and http://docs.opencv.org/modules/core/doc/operations_on_arrays.html
 
+The optional fast mode follows the fDSST variant proposed in [2]: the
+scale samples are compressed by PCA and the responses of fewer scale
+samples are interpolated to the full number of scales.
+
 References:
 [1] M. Danelljan, et al.,
 "Accurate Scale Estimation for Robust Visual Tracking,"
 in Proc. BMVC, 2014.
 
+[2] M. Danelljan, et al.,
+"Discriminative Scale Space Tracking,"
+in IEEE Trans. on PAMI, 2017.
+
 */
 
 #ifndef SCALE_ESTIMATOR_HPP_
@@ -54,12 +62,16 @@ in Proc. BMVC, 2014.
 #include <opencv2/core/core.hpp>
 #include <opencv2/core/traits.hpp>
 #include <algorithm>
+#include <memory>
+#include <vector>
 
 #include "mat_consts.hpp"
 #include "cv_ext.hpp"
 #include "feature_channels.hpp"
 #include "gradientMex.hpp"
 #include "math_helper.hpp"
+#include "feature_cache.hpp"
+#include "update_scheduler.hpp"
 
 namespace cf_tracking
 {
@@ -75,6 +87,11 @@ namespace cf_tracking
         T lambda = static_cast<T>(0.01);
         T learningRate = static_cast<T>(0.025);
 
+        // fast mode: numberOfScales compressed samples are
+        // interpolated to numberOfInterpScales responses
+        bool fastMode = false;
+        int numberOfInterpScales = 33;
+
         // testing
         bool useFhogTranspose = false;
         int resizeType = cv::INTER_LINEAR;
@@ -98,14 +115,19 @@ namespace cf_tracking
             _SCALE_MODEL_MAX_AREA(paras.scaleModelMaxArea),
             _SCALE_STEP(paras.scaleStep),
             _N_SCALES(paras.numberOfScales),
+            _N_INTERP_SCALES(paras.fastMode ? paras.numberOfInterpScales : paras.numberOfScales),
             _SCALE_SIGMA_FACTOR(paras.scaleSigmaFactor),
             _LAMBDA(paras.lambda),
             _LEARNING_RATE(paras.learningRate),
             _TYPE(cv::DataType<T>::type),
             _RESIZE_TYPE(paras.resizeType),
             _DEBUG_OUTPUT(paras.debugOutput),
-            _ORIGINAL_VERSION(paras.originalVersion)
+            _ORIGINAL_VERSION(paras.originalVersion),
+            _USE_FHOG_TRANSPOSE(paras.useFhogTranspose),
+            _FAST_MODE(paras.fastMode)
         {
+            CV_Assert(_N_INTERP_SCALES >= _N_SCALES);
+
             // init dft
             cv::Mat initDft = (cv::Mat_<T>(1, 1) << 1);
             dft(initDft, initDft);
@@ -122,7 +144,7 @@ namespace cf_tracking
             if (paras.useFhogTranspose)
                 fhogToCvCol = &piotr::fhogToCvColT;
             else
-                fhogToCvCol = &piotr::fhogToCol;
+                fhogToCvCol = &piotr::fhogToColRowMajor;
         }
 
         bool reinit(const cv::Mat& image, const Point& pos,
@@ -135,6 +157,18 @@ namespace cf_tracking
             T scaleHalf = static_cast<T>(ceil(_N_SCALES / 2.0));
 
             cv::Mat ss = colScales - scaleHalf;
+            T interpRatio = static_cast<T>(_N_INTERP_SCALES) / _N_SCALES;
+
+            if (_FAST_MODE)
+            {
+                // the interpolated response is periodic; center the labels
+                // at the first sample and measure in interpolated scales
+                scaleSigma = static_cast<T>(sqrt(_N_INTERP_SCALES) * _SCALE_SIGMA_FACTOR);
+
+                for (int i = 0; i < _N_SCALES; ++i)
+                    ss.at<T>(0, i) = centeredIndex(i, _N_SCALES) * interpRatio;
+            }
+
             cv::Mat ys;
             exp(-0.5 * ss.mul(ss) / (scaleSigma * scaleSigma), ys);
 
@@ -154,24 +188,47 @@ namespace cf_tracking
             }
 
             ss = scaleHalf - colScales;
+
+            if (_FAST_MODE)
+            {
+                ss = ss * interpRatio;
+                cv::Mat_<T> interpExponents(1, _N_INTERP_SCALES);
+
+                for (int i = 0; i < _N_INTERP_SCALES; ++i)
+                    interpExponents(0, i) = static_cast<T>(-centeredIndex(i, _N_INTERP_SCALES));
+
+                _interpScaleFactors = pow<T, T>(_SCALE_STEP, interpExponents);
+            }
+
             _scaleFactors = pow<T, T>(_SCALE_STEP, ss);
             _scaleModelFactor = sqrt(_SCALE_MODEL_MAX_AREA / targetSize.area());
             _scaleModelSz = sizeFloor(targetSize *  _scaleModelFactor);
 
-            // expand ysf to have the number of rows of scale samples
-            int ysfRow = static_cast<int>(floor(_scaleModelSz.width / _SCALE_CELL_SIZE)
+            _featureRows = static_cast<int>(floor(_scaleModelSz.width / _SCALE_CELL_SIZE)
                 * floor(_scaleModelSz.height / _SCALE_CELL_SIZE) * FFC::numberOfChannels());
 
-            _ysf = repeat(ysf, ysfRow, 1);
+            if (_FAST_MODE)
+            {
+                // one row for each principal axis of the scale samples
+                _ysf = repeat(ysf, _N_SCALES, 1);
 
-            cv::Mat sfNum, sfDen;
+                if (updateCompressedModel(image, pos, currentScaleFactor, 1) == false)
+                    return false;
+            }
+            else
+            {
+                // expand ysf to have the number of rows of scale samples
+                _ysf = repeat(ysf, _featureRows, 1);
 
-            if (getScaleTrainingData(image, pos,
-                currentScaleFactor, sfNum, sfDen) == false)
-                return false;
+                cv::Mat sfNum, sfDen;
 
-            _sfNumerator = sfNum;
-            _sfDenominator = sfDen;
+                if (getScaleTrainingData(image, pos,
+                    currentScaleFactor, sfNum, sfDen) == false)
+                    return false;
+
+                _sfNumerator = sfNum;
+                _sfDenominator = sfDen;
+            }
 
             _isInitialized = true;
             ++_frameIdx;
@@ -180,6 +237,19 @@ namespace cf_tracking
 
         virtual ~ScaleEstimator(){}
 
+        // share resized patches and fhog cells with other users
+        // of the same frame; the cache is ignored if the
+        // transposed fhog implementation is selected
+        void setFeatureCache(const std::shared_ptr<FeatureCache>& featureCache)
+        {
+            _featureCache = featureCache;
+        }
+
+        bool isInitialized() const
+        {
+            return _isInitialized;
+        }
+
         bool detectScale(const cv::Mat& image, const Point& pos,
             T& currentScaleFactor) const
         {
@@ -187,6 +257,9 @@ namespace cf_tracking
             if (getScaleFeatures(image, pos, xs, currentScaleFactor) == false)
                 return false;
 
+            if (_FAST_MODE)
+                xs = _scaleProjection * xs;
+
             cv::Mat xsf;
             dft(xs, xsf, cv::DFT_ROWS);
 
@@ -202,21 +275,36 @@ namespace cf_tracking
             cv::Mat scaleResponse;
             idft(responseSf, scaleResponse, cv::DFT_REAL_OUTPUT | cv::DFT_SCALE | cv::DFT_ROWS);
 
+            const cv::Mat* scaleFactors = &_scaleFactors;
+
+            if (_FAST_MODE)
+            {
+                interpolateResponse<T>(scaleResponse, cv::Size(_N_INTERP_SCALES, 1), scaleResponse);
+                scaleFactors = &_interpScaleFactors;
+            }
+
             cv::Point recoveredScale;
             double maxScaleResponse;
             minMaxLoc(scaleResponse, 0, &maxScaleResponse, 0, &recoveredScale);
 
-            currentScaleFactor *= _scaleFactors.at<T>(recoveredScale);
+            currentScaleFactor *= scaleFactors->at<T>(recoveredScale);
 
             currentScaleFactor = std::max(currentScaleFactor, _MIN_SCALE_FACTOR);
             currentScaleFactor = std::min(currentScaleFactor, _MAX_SCALE_FACTOR);
             return true;
         }
 
+        // frames is the number of frames covered by the update;
+        // the learning rate is compensated for the skipped updates
         bool updateScale(const cv::Mat& image, const Point& pos,
-            const T& currentScaleFactor)
+            const T& currentScaleFactor, int frames = 1)
         {
             ++_frameIdx;
+            const T learningRate = compensatedLearningRate(_LEARNING_RATE, frames);
+
+            if (_FAST_MODE)
+                return updateCompressedModel(image, pos, currentScaleFactor, learningRate);
+
             cv::Mat sfNum, sfDen;
 
             if (getScaleTrainingData(image, pos, currentScaleFactor,
@@ -224,12 +312,85 @@ namespace cf_tracking
                 return false;
 
             // both summands are in CCS packaged format; thus adding is OK
-            _sfDenominator = (1 - _LEARNING_RATE) * _sfDenominator + _LEARNING_RATE * sfDen;
-            _sfNumerator = (1 - _LEARNING_RATE) * _sfNumerator + _LEARNING_RATE * sfNum;
+            _sfDenominator = (1 - learningRate) * _sfDenominator + learningRate * sfDen;
+            _sfNumerator = (1 - learningRate) * _sfNumerator + learningRate * sfNum;
             return true;
         }
 
     private:
+        // index relative to the first element of a periodic sequence of length n
+        static int centeredIndex(int i, int n)
+        {
+            return (2 * i <= n) ? i : i - n;
+        }
+
+        // the compressed model keeps a running average of the scale samples;
+        // the numerator is learned from its projection onto its principal
+        // axes, which are used to compress the samples in detectScale
+        bool updateCompressedModel(const cv::Mat& image, const Point& pos,
+            const T& currentScaleFactor, T learningRate)
+        {
+            cv::Mat xs;
+            if (getScaleFeatures(image, pos, xs, currentScaleFactor) == false)
+                return false;
+
+            if (_sTemplate.empty() || learningRate == 1)
+                _sTemplate = xs;
+            else
+                _sTemplate = (1 - learningRate) * _sTemplate + learningRate * xs;
+
+            // the principal axes are obtained from the small gram matrix of
+            // the samples; the projection of the samples onto these axes
+            // equals the eigenvectors scaled by the square root of the
+            // eigenvalues, so the samples have to be projected only once
+            cv::Mat gram, eigenvectors, eigenvalues;
+            cv::mulTransposed(_sTemplate, gram, true);
+            pcaBasis<T>(gram, _N_SCALES, eigenvectors, eigenvalues);
+
+            if (eigenvectors.empty())
+                return false;
+
+            cv::Mat projectedTemplate = scaleRows(eigenvectors, eigenvalues, false);
+            _scaleProjection = scaleRows(eigenvectors, eigenvalues, true) * _sTemplate.t();
+
+            cv::Mat sf;
+            dft(projectedTemplate, sf, cv::DFT_ROWS);
+            mulSpectrums(_ysf.rowRange(0, sf.rows), sf, _sfNumerator, cv::DFT_ROWS, true);
+
+            // the energy spectrum of the compressed sample only depends on
+            // its gram matrix if it is projected onto its own principal axes
+            cv::mulTransposed(xs, gram, true);
+            pcaBasis<T>(gram, _N_SCALES, eigenvectors, eigenvalues);
+
+            cv::Mat xsf, mulTemp, sfDen;
+            dft(scaleRows(eigenvectors, eigenvalues, false), xsf, cv::DFT_ROWS);
+            mulSpectrums(xsf, xsf, mulTemp, cv::DFT_ROWS, true);
+            reduce(mulTemp, sfDen, 0, cv::REDUCE_SUM, -1);
+
+            if (learningRate == 1)
+                _sfDenominator = sfDen;
+            else
+                _sfDenominator = (1 - learningRate) * _sfDenominator + learningRate * sfDen;
+
+            return true;
+        }
+
+        // multiplies row i of m by the square root of eigenvalues(i)
+        // or by its reciprocal if inverse is set
+        static cv::Mat scaleRows(const cv::Mat& m, const cv::Mat& eigenvalues, bool inverse)
+        {
+            cv::Mat res = m.clone();
+
+            for (int i = 0; i < res.rows; ++i)
+            {
+                T factor = sqrt(eigenvalues.at<T>(i, 0));
+                cv::Mat row = res.row(i);
+                row *= (inverse ? 1 / factor : factor);
+            }
+
+            return res;
+        }
+
         bool getScaleTrainingData(const cv::Mat& image,
             const Point& pos,
             const T& currentScaleFactor,
@@ -251,51 +412,182 @@ namespace cf_tracking
         bool getScaleFeatures(const cv::Mat& image, const Point& pos,
             cv::Mat& features, T scale) const
         {
-            int colElems = _ysf.rows;
+            if (_featureCache && !_USE_FHOG_TRANSPOSE)
+                return getScaleFeaturesCached(image, pos, features, scale);
+
+            int colElems = _featureRows;
             features = cv::Mat::zeros(colElems, _N_SCALES, _TYPE);
-            cv::Mat patch;
-            cv::Mat patchResized;
-            cv::Mat patchResizedFloat;
             cv::Mat firstPatch;
-            T cosFactor = -1;
+            Point posInFirstPatch(0, 0);
 
             // do not extract features for first and last scale,
             // since the scaleWindow will always multiply these with 0;
-            // extract first required sub window separately; smaller scales are extracted
-            // from this patch to avoid multiple border replicates on out of image patches
-            int idxScale = 1;
-            T patchScale = scale * _scaleFactors.at<T>(0, idxScale);
-            Size firstPatchSize = sizeFloor(_targetSize * patchScale);
-            Point posInFirstPatch(0, 0);
-            cosFactor = _scaleWindow.at<T>(idxScale, 0);
+            // the original version extracts the first required sub window
+            // separately and takes the smaller scales from this patch to avoid
+            // multiple border replicates on out of image patches
+            if (_ORIGINAL_VERSION)
+            {
+                Size firstPatchSize = sizeFloor(_targetSize * (scale * _scaleFactors.at<T>(0, 1)));
 
-            if (getSubWindow(image, firstPatch, firstPatchSize, pos, &posInFirstPatch) == false)
-                return false;
+                if (getSubWindow(image, firstPatch, firstPatchSize, pos, &posInFirstPatch) == false)
+                    return false;
+            }
 
-            if (_ORIGINAL_VERSION)
-                depResize(firstPatch, patchResized, _scaleModelSz);
-            else
-                cv::resize(firstPatch, patchResized, _scaleModelSz, 0, 0, _RESIZE_TYPE);
+            // the scales only read the image or firstPatch and
+            // write their own column of features
+            std::vector<char> isValid(_N_SCALES, 1);
+
+#pragma omp parallel for
+            for (int idx = 1; idx < _N_SCALES - 1; ++idx)
+            {
+                cv::Mat patchFloat;
+                T cosFactor = _scaleWindow.at<T>(idx, 0);
+
+                if (getScalePatch(image, firstPatch, posInFirstPatch, pos, scale, idx,
+                    patchFloat, CV_32F) == false)
+                {
+                    isValid[idx] = 0;
+                    continue;
+                }
+
+                fhogToCvCol(patchFloat, features, _SCALE_CELL_SIZE, idx, cosFactor);
+            }
+
+            return std::find(isValid.begin(), isValid.end(), 0) == isValid.end();
+        }
+
+        // resized sub window of a scale; sampled directly from the image
+        // unless the original version resizes it from firstPatch
+        bool getScalePatch(const cv::Mat& image, const cv::Mat& firstPatch,
+            const Point& posInFirstPatch, const Point& pos, T scale, int idxScale,
+            cv::Mat& patch, int patchDepth) const
+        {
+            Size patchSize = sizeFloor(_targetSize * (scale * _scaleFactors.at<T>(0, idxScale)));
 
-            patchResized.convertTo(patchResizedFloat, CV_32FC(3));
-            fhogToCvCol(patchResizedFloat, features, _SCALE_CELL_SIZE, idxScale, cosFactor);
+            if (_ORIGINAL_VERSION == false)
+                return sampleSubWindow(image, patch, patchSize, pos,
+                    cv::Size(_scaleModelSz), _RESIZE_TYPE, patchDepth);
 
-            for (idxScale = 2; idxScale < _N_SCALES - 1; ++idxScale)
+            cv::Mat subWindow = firstPatch;
+
+            if (idxScale != 1 && getSubWindow(firstPatch, subWindow, patchSize, posInFirstPatch) == false)
+                return false;
+
+            cv::Mat patchResized;
+            depResize(subWindow, patchResized, _scaleModelSz);
+            patchResized.convertTo(patch, CV_MAKETYPE(patchDepth, patchResized.channels()));
+            return true;
+        }
+
+        // same as getScaleFeatures, but sub windows already resized
+        // and described in this frame are taken from the feature cache;
+        // the cache is only accessed outside of the parallel region
+        bool getScaleFeaturesCached(const cv::Mat& image, const Point& pos,
+            cv::Mat& features, T scale) const
+        {
+            FeatureCache& cache = *_featureCache;
+            features = cv::Mat::zeros(_featureRows, _N_SCALES, _TYPE);
+            const cv::Size scaleModelSz(_scaleModelSz);
+            const int resizeKey = (_ORIGINAL_VERSION ? FeatureCacheKey::DEP_RESIZE : _RESIZE_TYPE);
+
+            std::vector<FeatureCache::Entry*> entries(_N_SCALES, 0);
+            std::vector<FeatureCacheKey> newKeys;
+            std::vector<int> missing; // scales which require fhog cells
+            std::vector<std::pair<int, int> > duplicates; // (scale, index into missing)
+            bool extractPatches = false;
+
+            for (int idxScale = 1; idxScale < _N_SCALES - 1; ++idxScale)
             {
-                T patchScale = scale *_scaleFactors.at<T>(0, idxScale);
-                Size patchSize = sizeFloor(_targetSize * patchScale);
-                cosFactor = _scaleWindow.at<T>(idxScale, 0);
+                Size patchSize = sizeFloor(_targetSize * (scale * _scaleFactors.at<T>(0, idxScale)));
+                FeatureCacheKey key(getSubWindowRect(patchSize, pos), scaleModelSz, resizeKey);
+                FeatureCache::Entry* entry = cache.findPatch(key);
 
-                if (getSubWindow(firstPatch, patch, patchSize, posInFirstPatch) == false)
-                    return false;
+                if (entry == 0)
+                {
+                    entry = cache.insertPatch(key, cv::Mat());
+                    newKeys.push_back(key);
+                }
 
-                if (_ORIGINAL_VERSION)
-                    depResize(patch, patchResized, _scaleModelSz);
+                entries[idxScale] = entry;
+
+                // neighboring scales may map to the same sub window
+                std::vector<int>::const_iterator sameEntry = missing.begin();
+
+                while (sameEntry != missing.end() && entries[*sameEntry] != entry)
+                    ++sameEntry;
+
+                if (sameEntry != missing.end())
+                {
+                    duplicates.push_back(std::make_pair(idxScale,
+                        static_cast<int>(sameEntry - missing.begin())));
+                    continue;
+                }
+
+                const cv::Mat* cells = cache.findFhogCells(*entry, _SCALE_CELL_SIZE);
+
+                if (cells)
+                {
+                    piotr::fhogCellsToCol(*cells, features, idxScale, _scaleWindow.at<T>(idxScale, 0));
+                }
                 else
-                    cv::resize(patch, patchResized, _scaleModelSz, 0, 0, _RESIZE_TYPE);
+                {
+                    missing.push_back(idxScale);
+                    extractPatches |= entry->patch.empty();
+                }
+            }
+
+            // the first sub window of the original version is only
+            // extracted if required; smaller scales are still extracted from it
+            cv::Mat firstPatch;
+            Point posInFirstPatch(0, 0);
+            bool isValid = true;
+
+            if (extractPatches && _ORIGINAL_VERSION)
+            {
+                Size firstPatchSize = sizeFloor(_targetSize * (scale * _scaleFactors.at<T>(0, 1)));
+                isValid = getSubWindow(image, firstPatch, firstPatchSize, pos, &posInFirstPatch);
+            }
+
+            const int nMissing = (isValid ? static_cast<int>(missing.size()) : 0);
+            std::vector<cv::Mat> missingCells(nMissing);
+            std::vector<char> isValidMissing(nMissing, 1);
+
+#pragma omp parallel for
+            for (int i = 0; i < nMissing; ++i)
+            {
+                int idxScale = missing[i];
+                FeatureCache::Entry& entry = *entries[idxScale];
+
+                if (entry.patch.empty() && getScalePatch(image, firstPatch, posInFirstPatch,
+                    pos, scale, idxScale, entry.patch, CV_8U) == false)
+                {
+                    isValidMissing[i] = 0;
+                    continue;
+                }
+
+                missingCells[i] = FeatureCache::computeFhogCells(entry, _SCALE_CELL_SIZE);
+                piotr::fhogCellsToCol(missingCells[i], features, idxScale, _scaleWindow.at<T>(idxScale, 0));
+            }
 
-                patchResized.convertTo(patchResizedFloat, CV_32FC(3));
-                fhogToCvCol(patchResizedFloat, features, _SCALE_CELL_SIZE, idxScale, cosFactor);
+            isValid = isValid && std::find(isValidMissing.begin(), isValidMissing.end(), 0) == isValidMissing.end();
+
+            if (isValid == false)
+            {
+                // do not keep sub windows without patch
+                for (size_t i = 0; i < newKeys.size(); ++i)
+                    cache.erasePatch(newKeys[i]);
+
+                return false;
+            }
+
+            for (int i = 0; i < nMissing; ++i)
+                cache.storeFhogCells(*entries[missing[i]], _SCALE_CELL_SIZE, true, missingCells[i]);
+
+            for (size_t i = 0; i < duplicates.size(); ++i)
+            {
+                int idxScale = duplicates[i].first;
+                piotr::fhogCellsToCol(missingCells[duplicates[i].second], features,
+                    idxScale, _scaleWindow.at<T>(idxScale, 0));
             }
 
             return true;
@@ -314,6 +606,11 @@ namespace cf_tracking
         Size _scaleModelSz;
         Size _targetSize;
         cv::Mat _ysf;
+        cv::Mat _interpScaleFactors;
+        cv::Mat _sTemplate;
+        cv::Mat _scaleProjection;
+        int _featureRows = 0;
+        std::shared_ptr<FeatureCache> _featureCache;
         int _frameIdx;
         bool _isInitialized;
 
@@ -322,6 +619,7 @@ namespace cf_tracking
         const T _SCALE_MODEL_MAX_AREA;
         const T _SCALE_STEP;
         const int _N_SCALES;
+        const int _N_INTERP_SCALES;
         const T _SCALE_SIGMA_FACTOR;
         const T _LAMBDA;
         const T _LEARNING_RATE;
@@ -332,6 +630,8 @@ namespace cf_tracking
 
         const bool _DEBUG_OUTPUT;
         const bool _ORIGINAL_VERSION;
+        const bool _USE_FHOG_TRANSPOSE;
+        const bool _FAST_MODE;
     };
 }
 
@@ -0,0 +1,136 @@
+/*
+// License Agreement (3-clause BSD License)
+// Copyright (c) 2015, Klaus Haag, all rights reserved.
+// Third party copyrights and patents are property of their respective owners.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the names of the copyright holders nor the names of the contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall copyright holders or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+*/
+
+/*
+The update scheduler decides per frame whether the translation filter and
+the scale filter of a tracker are updated. While the response of the
+translation filter is stable, i.e. its PSR is at least stablePsr, the
+translation filter is only updated every translationInterval frames and
+the scale filter every scaleInterval frames. An unstable response updates
+both filters in every frame, as does the default configuration.
+
+Skipped updates are compensated by the learning rate. k updates with the
+same sample and learning rate lr weight the sample by 1 - (1 - lr)^k,
+which is used as the learning rate of an update after k frames.
+*/
+
+#ifndef UPDATE_SCHEDULER_HPP_
+#define UPDATE_SCHEDULER_HPP_
+
+#include <algorithm>
+#include <cmath>
+
+namespace cf_tracking
+{
+    struct UpdateSchedulerParas
+    {
+        int translationInterval = 1;
+        int scaleInterval = 1;
+        double stablePsr = 20.0;
+        bool compensateLearningRate = true;
+    };
+
+    // learning rate of a single update which replaces
+    // the updates of the given number of frames
+    template<typename T>
+    T compensatedLearningRate(T learningRate, int frames)
+    {
+        if (frames <= 1)
+            return learningRate;
+
+        return static_cast<T>(1 - std::pow(1 - learningRate, frames));
+    }
+
+    template<typename T>
+    class UpdateScheduler
+    {
+    public:
+        explicit UpdateScheduler(const UpdateSchedulerParas& paras)
+            : _TRANSLATION_INTERVAL(std::max(1, paras.translationInterval)),
+            _SCALE_INTERVAL(std::max(1, paras.scaleInterval)),
+            _STABLE_PSR(static_cast<T>(paras.stablePsr)),
+            _COMPENSATE_LEARNING_RATE(paras.compensateLearningRate)
+        {}
+
+        // call after the model has been (re)initialized
+        void reset()
+        {
+            _translationFrames = 0;
+            _scaleFrames = 0;
+            _isStable = false;
+        }
+
+        // call once per successfully tracked frame
+        // with the PSR of the translation response
+        void nextFrame(T psr)
+        {
+            ++_translationFrames;
+            ++_scaleFrames;
+            _isStable = (psr >= _STABLE_PSR);
+        }
+
+        // returns true if the translation filter is updated in this frame;
+        // frames receives the number of frames covered by the update, see
+        // compensatedLearningRate; it is not changed if false is returned
+        bool scheduleTranslation(int& frames)
+        {
+            return schedule(_translationFrames, _TRANSLATION_INTERVAL, frames);
+        }
+
+        // same as scheduleTranslation for the scale filter
+        bool scheduleScale(int& frames)
+        {
+            return schedule(_scaleFrames, _SCALE_INTERVAL, frames);
+        }
+
+    private:
+        bool schedule(int& framesSinceUpdate, int interval, int& frames)
+        {
+            if (_isStable && framesSinceUpdate < interval)
+                return false;
+
+            frames = (_COMPENSATE_LEARNING_RATE ? framesSinceUpdate : 1);
+            framesSinceUpdate = 0;
+            return true;
+        }
+
+        int _translationFrames = 0;
+        int _scaleFrames = 0;
+        bool _isStable = false;
+
+        const int _TRANSLATION_INTERVAL;
+        const int _SCALE_INTERVAL;
+        const T _STABLE_PSR;
+        const bool _COMPENSATE_LEARNING_RATE;
+    };
+}
+
+#endif
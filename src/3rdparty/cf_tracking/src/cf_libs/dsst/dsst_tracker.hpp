@@ -40,6 +40,15 @@ has to be expected.
 
 Additionally, target loss detection is implemented according to [2].
 
+The optional fast mode follows the fDSST variant proposed in [3]: the
+translation features are compressed by PCA and the translation filter
+is learned on a coarser grid; its response is interpolated to the
+template resolution. See scale_estimator.hpp for the scale filter.
+
+The translation features are computed by the extractor given as template
+argument; see feature_extractors.hpp. DsstTracker uses the original FHOG
+and gray-scale features. The scale filter always uses FHOG features.
+
 Every complex matrix is as default in CCS packed form:
 see: https://software.intel.com/en-us/node/504243
 and http://docs.opencv.org/modules/core/doc/operations_on_arrays.html
@@ -52,6 +61,10 @@ in Proc. BMVC, 2014.
 [2] D. Bolme, et al.,
 Visual Object Tracking using Adaptive Correlation Filters,
 in Proc. CVPR, 2010.
+
+[3] M. Danelljan, et al.,
+"Discriminative Scale Space Tracking,"
+in IEEE Trans. on PAMI, 2017.
 */
 
 #ifndef DSST_TRACKER_HPP_
@@ -71,6 +84,9 @@ in Proc. CVPR, 2010.
 #include "math_helper.hpp"
 #include "cf_tracker.hpp"
 #include "scale_estimator.hpp"
+#include "feature_cache.hpp"
+#include "feature_extractors.hpp"
+#include "update_scheduler.hpp"
 #include "dsst_debug.hpp"
 #include "psr.hpp"
 
@@ -95,13 +111,46 @@ namespace cf_tracking
         int scaleCellSize = 4;
         int numberOfScales = 33;
 
+        // reuse resized patches and fhog cells within a frame;
+        // only used with the row major fhog implementation
+        bool enableFeatureCache = true;
+        bool cacheFhogCells = true;
+
+        // build the translation training sample by shifting the
+        // spectrum of the detection sample instead of extracting
+        // features at the new position; only used if the scale did
+        // not change and the displacement is at most maxReuseShift cells
+        bool reuseDetectionFeatures = false;
+        double maxReuseShift = 1.0;
+
+        // fast DSST [3]; replaces cellSize by fastCellSize and samples
+        // fastNumberOfScales scales, which are interpolated to
+        // numberOfScales; reuseDetectionFeatures is ignored; the PSR
+        // is evaluated on the interpolated response sampled at cellSize,
+        // so psrThreshold and psrPeakDel keep their meaning
+        bool enableFastMode = false;
+        int fastCellSize = 4;
+        int fastNumberOfScales = 17;
+
+        // update the translation and scale filters only every
+        // translationUpdateInterval and scaleUpdateInterval frames
+        // while the PSR is at least stableUpdatePsr; see UpdateScheduler
+        int translationUpdateInterval = 1;
+        int scaleUpdateInterval = 1;
+        double stableUpdatePsr = 20.0;
+        bool compensateSkippedUpdates = true;
+
         //testing
         bool originalVersion = false;
         int resizeType = cv::INTER_LINEAR;
         bool useFhogTranspose = false;
+
+        // required if the tracker uses ColorNamesFeatureExtractor
+        std::shared_ptr<const cv::Mat> colorNamesTable;
     };
 
-    class DsstTracker : public CfTracker
+    template<template<class> class FEATURES>
+    class DsstTracker_ : public CfTracker
     {
     public:
         typedef float T; // set precision here double or float
@@ -109,21 +158,25 @@ namespace cf_tracking
         typedef cv::Size_<T> Size;
         typedef cv::Point_<T> Point;
         typedef cv::Rect_<T> Rect;
-        typedef FhogFeatureChannels<T> FFC;
-        typedef DsstFeatureChannels<T> DFC;
+        typedef FEATURES<T> FE;
+        typedef typename FE::FC DFC;
+        typedef FastDsstFeatureChannels<FE::NUMBER_OF_CHANNELS, T> FDFC;
         typedef mat_consts::constants<T> consts;
 
-        DsstTracker(DsstParameters paras, DsstDebug<T>* debug = 0)
-            : _isInitialized(false),
+        DsstTracker_(DsstParameters paras, DsstDebug<T>* debug = 0)
+            : _extractor(getExtractorParas(paras)),
+            _updateScheduler(getSchedulerParas(paras)),
+            _isInitialized(false),
             _scaleEstimator(0),
             _PADDING(static_cast<T>(paras.padding)),
             _OUTPUT_SIGMA_FACTOR(static_cast<T>(paras.outputSigmaFactor)),
             _LAMBDA(static_cast<T>(paras.lambda)),
             _LEARNING_RATE(static_cast<T>(paras.learningRate)),
-            _CELL_SIZE(paras.cellSize),
+            _CELL_SIZE(paras.enableFastMode ? paras.fastCellSize : paras.cellSize),
             _TEMPLATE_SIZE(paras.templateSize),
             _PSR_THRESHOLD(static_cast<T>(paras.psrThreshold)),
             _PSR_PEAK_DEL(paras.psrPeakDel),
+            _PSR_STRIDE(paras.cellSize),
             _MIN_AREA(10),
             _MAX_AREA_FACTOR(0.8),
             _ID("DSSTcpp"),
@@ -131,6 +184,9 @@ namespace cf_tracking
             _ORIGINAL_VERSION(paras.originalVersion),
             _RESIZE_TYPE(paras.resizeType),
             _USE_CCS(true),
+            _REUSE_DETECTION_FEATURES(paras.reuseDetectionFeatures && !paras.enableFastMode),
+            _MAX_REUSE_SHIFT(static_cast<T>(paras.maxReuseShift)),
+            _FAST_MODE(paras.enableFastMode),
             _debug(debug)
         {
             if (paras.enableScaleEstimator)
@@ -145,13 +201,25 @@ namespace cf_tracking
                 sp.useFhogTranspose = paras.useFhogTranspose;
                 sp.resizeType = paras.resizeType;
                 sp.originalVersion = paras.originalVersion;
+
+                if (paras.enableFastMode)
+                {
+                    sp.fastMode = true;
+                    sp.numberOfScales = paras.fastNumberOfScales;
+                    sp.numberOfInterpScales = paras.numberOfScales;
+                }
+
+                _scaleParas = sp;
                 _scaleEstimator = new ScaleEstimator<T>(sp);
             }
 
-            if (paras.useFhogTranspose)
-                cvFhog = &piotr::cvFhogT < T, DFC > ;
-            else
-                cvFhog = &piotr::cvFhog < T, DFC > ;
+            if (paras.enableFeatureCache && !paras.useFhogTranspose)
+            {
+                _featureCache.reset(new FeatureCache(paras.cacheFhogCells));
+
+                if (_scaleEstimator)
+                    _scaleEstimator->setFeatureCache(_featureCache);
+            }
 
             if (_USE_CCS)
                 calcDft = &cf_tracking::dftCcs;
@@ -169,7 +237,7 @@ namespace cf_tracking
             }
         }
 
-        virtual ~DsstTracker()
+        virtual ~DsstTracker_()
         {
             delete _scaleEstimator;
         }
@@ -342,15 +410,67 @@ namespace cf_tracking
             return _ID;
         }
 
+        virtual int getNumberOfScales()
+        {
+            return _scaleEstimator ? _scaleParas.numberOfScales : 0;
+        }
+
+        virtual void setNumberOfScales(int numberOfScales)
+        {
+            // in fast mode, more samples than interpolated scales are not supported
+            if (_scaleParas.fastMode)
+                numberOfScales = std::min(numberOfScales, _scaleParas.numberOfInterpScales);
+
+            if (_scaleEstimator == 0 || numberOfScales < 1
+                || numberOfScales == _scaleParas.numberOfScales)
+                return;
+
+            _scaleParas.numberOfScales = numberOfScales;
+            delete _scaleEstimator;
+            _scaleEstimator = new ScaleEstimator<T>(_scaleParas);
+
+            if (_featureCache)
+                _scaleEstimator->setFeatureCache(_featureCache);
+        }
+
+        // returns 0 if the feature cache is disabled
+        std::shared_ptr<const FeatureCache> getFeatureCache() const
+        {
+            return _featureCache;
+        }
+
     private:
-        DsstTracker& operator=(const DsstTracker&)
+        DsstTracker_& operator=(const DsstTracker_&)
         {}
 
+        static FeatureExtractorParameters getExtractorParas(const DsstParameters& paras)
+        {
+            FeatureExtractorParameters fp;
+            fp.useFhogTranspose = paras.useFhogTranspose;
+            fp.resizeType = paras.resizeType;
+            fp.colorNamesTable = paras.colorNamesTable;
+            return fp;
+        }
+
+        static UpdateSchedulerParas getSchedulerParas(const DsstParameters& paras)
+        {
+            UpdateSchedulerParas up;
+            up.translationInterval = paras.translationUpdateInterval;
+            up.scaleInterval = paras.scaleUpdateInterval;
+            up.stablePsr = paras.stableUpdatePsr;
+            up.compensateLearningRate = paras.compensateSkippedUpdates;
+            return up;
+        }
+
         bool reinit_(const cv::Mat& image, Rect& boundingBox)
         {
+            if (_featureCache)
+                _featureCache->newFrame();
+
             _pos.x = floor(boundingBox.x) + floor(boundingBox.width * consts::c0_5);
             _pos.y = floor(boundingBox.y) + floor(boundingBox.height * consts::c0_5);
             Size targetSize = Size(boundingBox.width, boundingBox.height);
+            _scaleTargetSize = targetSize;
 
             _templateSz = Size(floor(targetSize.width * (1 + _PADDING)),
                 floor(targetSize.height * (1 + _PADDING)));
@@ -387,14 +507,22 @@ namespace cf_tracking
             cosWindowX = hanningWindow<T>(_yf.cols);
             _cosWindow = cosWindowY * cosWindowX.t();
 
-            std::shared_ptr<DFC> hfNum(0);
-            cv::Mat hfDen;
+            if (_FAST_MODE)
+            {
+                if (updateCompressedModel(image, _pos, 1) == false)
+                    return false;
+            }
+            else
+            {
+                std::shared_ptr<DFC> hfNum(0);
+                cv::Mat hfDen;
 
-            if (getTranslationTrainingData(image, hfNum, hfDen, _pos) == false)
-                return false;
+                if (getTranslationTrainingData(image, hfNum, hfDen, _pos) == false)
+                    return false;
 
-            _hfNumerator = hfNum;
-            _hfDenominator = hfDen;
+                _hfNumerator = hfNum;
+                _hfDenominator = hfDen;
+            }
 
             if (_scaleEstimator)
             {
@@ -403,27 +531,74 @@ namespace cf_tracking
             }
 
             _lastBoundingBox = boundingBox;
+            _updateScheduler.reset();
             _isInitialized = true;
             return true;
         }
 
+        // features are only extracted at pos if xtf is not set
         bool getTranslationTrainingData(const cv::Mat& image, std::shared_ptr<DFC>& hfNum,
-            cv::Mat& hfDen, const Point& pos) const
+            cv::Mat& hfDen, const Point& pos, std::shared_ptr<DFC> xtf = 0) const
+        {
+            if (xtf == 0)
+            {
+                std::shared_ptr<DFC> xt(0);
+
+                if (getTranslationFeatures(image, xt, pos, _scale) == false)
+                    return false;
+
+                if (_USE_CCS)
+                    xtf = DFC::dftFeatures(xt);
+                else
+                    xtf = DFC::dftFeatures(xt, cv::DFT_COMPLEX_OUTPUT);
+            }
+
+            hfNum = DFC::mulSpectrumsFeatures(_yf, xtf, true);
+            hfDen = DFC::sumFeatures(DFC::mulSpectrumsFeatures(xtf, xtf, true));
+
+            return true;
+        }
+
+        // fast mode: the numerator is learned from a running average of the
+        // translation samples projected onto its principal axes; these axes
+        // compress the samples for the denominator and for detection
+        bool updateCompressedModel(const cv::Mat& image, const Point& pos, T learningRate)
         {
             std::shared_ptr<DFC> xt(0);
 
             if (getTranslationFeatures(image, xt, pos, _scale) == false)
                 return false;
 
-            std::shared_ptr<DFC> xtf;
-
-            if (_USE_CCS)
-                xtf = DFC::dftFeatures(xt);
+            if (_xtTemplate == 0 || learningRate == 1)
+            {
+                _xtTemplate = xt;
+            }
             else
-                xtf = DFC::dftFeatures(xt, cv::DFT_COMPLEX_OUTPUT);
+            {
+                for (int i = 0; i < DFC::numberOfChannels(); ++i)
+                {
+                    cv::addWeighted(_xtTemplate->channels[i], 1 - learningRate,
+                        xt->channels[i], learningRate, 0, _xtTemplate->channels[i]);
+                }
+            }
 
-            hfNum = DFC::mulSpectrumsFeatures(_yf, xtf, true);
-            hfDen = DFC::sumFeatures(DFC::mulSpectrumsFeatures(xtf, xtf, true));
+            cv::Mat eigenvalues;
+            pcaBasis<T>(DFC::gramFeatures(_xtTemplate), FDFC::numberOfChannels(),
+                _projection, eigenvalues);
+
+            int dftFlags = (_USE_CCS ? 0 : cv::DFT_COMPLEX_OUTPUT);
+            std::shared_ptr<FDFC> ztf = FDFC::dftFeatures(
+                DFC::template projectFeatures<FDFC>(_xtTemplate, _projection), dftFlags);
+            _hfNumeratorCompressed = FDFC::mulSpectrumsFeatures(_yf, ztf, true);
+
+            std::shared_ptr<FDFC> xtf = FDFC::dftFeatures(
+                DFC::template projectFeatures<FDFC>(xt, _projection), dftFlags);
+            cv::Mat hfDen = FDFC::sumFeaturesInPlace(FDFC::mulSpectrumsFeatures(xtf, xtf, true));
+
+            if (learningRate == 1)
+                _hfDenominator = hfDen;
+            else
+                _hfDenominator = (1 - learningRate) * _hfDenominator + learningRate * hfDen;
 
             return true;
         }
@@ -433,45 +608,50 @@ namespace cf_tracking
         {
             cv::Mat patch;
             Size patchSize = _templateSz * scale;
+            FeatureCache::Entry* entry = 0;
 
-            if (getSubWindow(image, patch, patchSize, pos) == false)
-                return false;
+            if (_featureCache)
+            {
+                FeatureCacheKey key(getSubWindowRect(patchSize, pos), cv::Size(_templateSz),
+                    _ORIGINAL_VERSION ? FeatureCacheKey::DEP_RESIZE : _RESIZE_TYPE);
+                entry = _featureCache->findPatch(key);
 
-            if (_ORIGINAL_VERSION)
-                depResize(patch, patch, _templateSz);
-            else
-                resize(patch, patch, _templateSz, 0, 0, _RESIZE_TYPE);
+                if (entry == 0)
+                {
+                    if (extractTranslationPatch(image, patch, patchSize, pos) == false)
+                        return false;
+
+                    entry = _featureCache->insertPatch(key, patch);
+                }
+                else
+                {
+                    patch = entry->patch;
+                }
+            }
+            else if (extractTranslationPatch(image, patch, patchSize, pos) == false)
+            {
+                return false;
+            }
 
             if (_debug != 0)
                 _debug->showPatch(patch);
 
-            cv::Mat floatPatch;
-            patch.convertTo(floatPatch, CV_32FC(3));
-
-            features.reset(new DFC());
-            cvFhog(floatPatch, features, _CELL_SIZE, DFC::numberOfChannels() - 1);
-
-            // append gray-scale image
-            if (patch.channels() == 1)
-            {
-                if (_CELL_SIZE != 1)
-                    resize(patch, patch, features->channels[0].size(), 0, 0, _RESIZE_TYPE);
+            // fhog based extractors take the cells from the cache entry
+            // the cosine window is applied while the features are written
+            _extractor.extract(patch, _CELL_SIZE, features, _cosWindow, _featureCache.get(), entry);
+            return true;
+        }
 
-                features->channels[DFC::numberOfChannels() - 1] = patch / 255.0 - 0.5;
-            }
-            else
-            {
-                if (_CELL_SIZE != 1)
-                    resize(patch, patch, features->channels[0].size(), 0, 0, _RESIZE_TYPE);
+        bool extractTranslationPatch(const cv::Mat& image, cv::Mat& patch,
+            const Size& patchSize, const Point& pos) const
+        {
+            if (_ORIGINAL_VERSION == false)
+                return sampleSubWindow(image, patch, patchSize, pos, cv::Size(_templateSz), _RESIZE_TYPE);
 
-                cv::Mat grayFrame;
-                cvtColor(patch, grayFrame, cv::COLOR_BGR2GRAY);
-                grayFrame.convertTo(grayFrame, CV_TYPE);
-                grayFrame = grayFrame / 255.0 - 0.5;
-                features->channels[DFC::numberOfChannels() - 1] = grayFrame;
-            }
+            if (getSubWindow(image, patch, patchSize, pos) == false)
+                return false;
 
-            DFC::mulFeatures(features, _cosWindow);
+            depResize(patch, patch, _templateSz);
             return true;
         }
 
@@ -507,15 +687,20 @@ namespace cf_tracking
             if (!_isInitialized)
                 return false;
 
+            if (_featureCache)
+                _featureCache->newFrame();
+
             T newScale = oldScale;
             Point newPos = oldPos;
-            cv::Point2i maxResponseIdx;
+            ResponseAnalysis<T> analysis;
             cv::Mat response;
+            std::shared_ptr<DFC> detectionXtf(0);
 
             // in case of error return the last box
             boundingBox = _lastBoundingBox;
 
-            if (detectModel(image, response, maxResponseIdx, newPos, newScale) == false)
+            if (detectModel(image, response, analysis, newPos, newScale,
+                detectionXtf) == false)
                 return false;
 
             // return box
@@ -527,12 +712,23 @@ namespace cf_tracking
 
             if (_ENABLE_TRACKING_LOSS_DETECTION)
             {
-                if (evalReponse(image, response, maxResponseIdx,
+                if (evalReponse(image, response, analysis,
                     tempBoundingBox) == false)
                     return false;
             }
 
-            if (updateModel(image, newPos, newScale) == false)
+            int translationFrames = 0;
+            int scaleFrames = 0;
+            _updateScheduler.nextFrame(analysis.psr());
+            _updateScheduler.scheduleTranslation(translationFrames);
+            _updateScheduler.scheduleScale(scaleFrames);
+
+            std::shared_ptr<DFC> xtf(0);
+
+            if (_REUSE_DETECTION_FEATURES && translationFrames > 0)
+                xtf = shiftDetectionSpectrum(detectionXtf, oldPos, oldScale, newPos, newScale);
+
+            if (updateModel(image, newPos, newScale, xtf, translationFrames, scaleFrames) == false)
                 return false;
 
             boundingBox &= Rect(0, 0, static_cast<T>(image.cols), static_cast<T>(image.rows));
@@ -542,15 +738,14 @@ namespace cf_tracking
         }
 
         bool evalReponse(const cv::Mat &image, const cv::Mat& response,
-            const cv::Point2i& maxResponseIdx,
+            const ResponseAnalysis<T>& analysis,
             const Rect& tempBoundingBox) const
         {
-            T peakValue = 0;
-            T psrClamped = calcPsr(response, maxResponseIdx, _PSR_PEAK_DEL, peakValue);
+            T psrClamped = analysis.psr();
 
             if (_debug != 0)
             {
-                _debug->showResponse(response, peakValue);
+                _debug->showResponse(response, analysis.peakValue);
                 _debug->setPsr(psrClamped);
             }
 
@@ -571,9 +766,11 @@ namespace cf_tracking
             return true;
         }
 
+        // detectionXtf receives the spectrum of the detection sample
+        // extracted at the initial newPos and newScale
         bool detectModel(const cv::Mat& image, cv::Mat& response,
-            cv::Point2i& maxResponseIdx, Point& newPos,
-            T& newScale) const
+            ResponseAnalysis<T>& analysis, Point& newPos,
+            T& newScale, std::shared_ptr<DFC>& detectionXtf) const
         {
             // find translation
             std::shared_ptr<DFC> xt(0);
@@ -581,14 +778,24 @@ namespace cf_tracking
             if (getTranslationFeatures(image, xt, newPos, newScale) == false)
                 return false;
 
-            std::shared_ptr<DFC> xtf;
-            if (_USE_CCS)
-                xtf = DFC::dftFeatures(xt);
+            int dftFlags = (_USE_CCS ? 0 : cv::DFT_COMPLEX_OUTPUT);
+            cv::Mat sumXtf;
+
+            if (_FAST_MODE)
+            {
+                std::shared_ptr<FDFC> ztf = FDFC::dftFeatures(
+                    DFC::template projectFeatures<FDFC>(xt, _projection), dftFlags);
+                sumXtf = FDFC::sumFeaturesInPlace(
+                    FDFC::mulSpectrumsFeatures(_hfNumeratorCompressed, ztf, false));
+            }
             else
-                xtf = DFC::dftFeatures(xt, cv::DFT_COMPLEX_OUTPUT);
+            {
+                std::shared_ptr<DFC> xtf = DFC::dftFeatures(xt, dftFlags);
+                std::shared_ptr<DFC> sampleSpec = DFC::mulSpectrumsFeatures(_hfNumerator, xtf, false);
+                sumXtf = DFC::sumFeatures(sampleSpec);
+                detectionXtf = xtf;
+            }
 
-            std::shared_ptr<DFC> sampleSpec = DFC::mulSpectrumsFeatures(_hfNumerator, xtf, false);
-            cv::Mat sumXtf = DFC::sumFeatures(sampleSpec);
             cv::Mat hfDenLambda = addRealToSpectrum<T>(_LAMBDA, _hfDenominator);
             cv::Mat responseTf;
 
@@ -599,25 +806,40 @@ namespace cf_tracking
 
             cv::Mat translationResponse;
             idft(responseTf, translationResponse, cv::DFT_REAL_OUTPUT | cv::DFT_SCALE);
-
-            cv::Point delta;
-            double maxResponse;
+            cv::Size cellGridSz = translationResponse.size();
             cv::Point_<T> subDelta;
-            minMaxLoc(translationResponse, 0, &maxResponse, 0, &delta);
-            subDelta = delta;
 
-            if (_CELL_SIZE != 1)
-                subDelta = subPixelDelta<T>(translationResponse, delta);
+            if (_FAST_MODE)
+            {
+                // locate the peak in the response interpolated to the
+                // template resolution; the PSR is taken from the samples at
+                // the cellSize of the normal mode, for which the threshold
+                // is tuned; the peak window is clipped at the borders
+                interpolateResponse<T>(translationResponse, cellGridSz * _CELL_SIZE, translationResponse);
+                analyzeResponse(translationResponse, _PSR_PEAK_DEL * _PSR_STRIDE, cv::Point2i(0, 0), analysis);
+                latticeSideLobe(translationResponse, _PSR_STRIDE, _PSR_PEAK_DEL, analysis);
+                subDelta.x = analysis.peakIdx.x / static_cast<T>(_CELL_SIZE);
+                subDelta.y = analysis.peakIdx.y / static_cast<T>(_CELL_SIZE);
+            }
+            else
+            {
+                // the peak window is clipped at the borders
+                analyzeResponse(translationResponse, _PSR_PEAK_DEL, cv::Point2i(0, 0), analysis);
+                subDelta = analysis.peakIdx;
+
+                if (_CELL_SIZE != 1)
+                    subDelta = subPixelDelta<T>(analysis.peakIdx, analysis.vNeighbors, analysis.hNeighbors);
+            }
 
-            T posDeltaX = (subDelta.x + 1 - floor(translationResponse.cols / consts::c2_0)) * newScale;
-            T posDeltaY = (subDelta.y + 1 - floor(translationResponse.rows / consts::c2_0)) * newScale;
+            T posDeltaX = (subDelta.x + 1 - floor(cellGridSz.width / consts::c2_0)) * newScale;
+            T posDeltaY = (subDelta.y + 1 - floor(cellGridSz.height / consts::c2_0)) * newScale;
             newPos.x += round(posDeltaX * _CELL_SIZE);
             newPos.y += round(posDeltaY * _CELL_SIZE);
 
             if (_debug != 0)
-                _debug->showResponse(translationResponse, maxResponse);
+                _debug->showResponse(translationResponse, analysis.peakValue);
 
-            if (_scaleEstimator)
+            if (_scaleEstimator && _scaleEstimator->isInitialized())
             {
                 //find scale
                 T tempScale = newScale * _templateScaleFactor;
@@ -630,39 +852,86 @@ namespace cf_tracking
             }
 
             response = translationResponse;
-            maxResponseIdx = delta;
             return true;
         }
 
+        // the spectrum of the translation training sample is extracted
+        // at newPos if xtf is not set; translationFrames and scaleFrames
+        // are the number of frames covered by the update of the filters;
+        // a filter is not updated if it is 0
         bool updateModel(const cv::Mat& image, const Point& newPos,
-            T newScale)
+            T newScale, const std::shared_ptr<DFC>& xtf = 0,
+            int translationFrames = 1, int scaleFrames = 1)
         {
             _pos = newPos;
             _scale = newScale;
-            std::shared_ptr<DFC> hfNum(0);
-            cv::Mat hfDen;
+            const T learningRate = compensatedLearningRate(_LEARNING_RATE, translationFrames);
 
-            if (getTranslationTrainingData(image, hfNum, hfDen, _pos) == false)
-                return false;
+            if (translationFrames > 0 && _FAST_MODE)
+            {
+                if (updateCompressedModel(image, _pos, learningRate) == false)
+                    return false;
+            }
+            else if (translationFrames > 0)
+            {
+                std::shared_ptr<DFC> hfNum(0);
+                cv::Mat hfDen;
 
-            _hfDenominator = (1 - _LEARNING_RATE) * _hfDenominator + _LEARNING_RATE * hfDen;
-            DFC::mulValueFeatures(_hfNumerator, (1 - _LEARNING_RATE));
-            DFC::mulValueFeatures(hfNum, _LEARNING_RATE);
-            DFC::addFeatures(_hfNumerator, hfNum);
+                if (getTranslationTrainingData(image, hfNum, hfDen, _pos, xtf) == false)
+                    return false;
 
-            if (_scaleEstimator)
+                _hfDenominator = (1 - learningRate) * _hfDenominator + learningRate * hfDen;
+                DFC::mulValueFeatures(_hfNumerator, (1 - learningRate));
+                DFC::mulValueFeatures(hfNum, learningRate);
+                DFC::addFeatures(_hfNumerator, hfNum);
+            }
+
+            if (_scaleEstimator && !_scaleEstimator->isInitialized())
             {
-                if (_scaleEstimator->updateScale(image, newPos, newScale * _templateScaleFactor) == false)
+                // the scale filter was rebuilt by setNumberOfScales
+                if (_scaleEstimator->reinit(image, newPos, _scaleTargetSize,
+                    newScale * _templateScaleFactor) == false)
+                    return false;
+            }
+            else if (_scaleEstimator && scaleFrames > 0)
+            {
+                if (_scaleEstimator->updateScale(image, newPos,
+                    newScale * _templateScaleFactor, scaleFrames) == false)
                     return false;
             }
 
             return true;
         }
 
+        // spectrum of the translation sample at newPos obtained by circularly
+        // shifting the spectrum of the detection sample; the cosine window
+        // moves with the sample, hence this is only an approximation for
+        // small displacements; returns 0 if features have to be extracted
+        std::shared_ptr<DFC> shiftDetectionSpectrum(const std::shared_ptr<DFC>& xtf,
+            const Point& detectionPos, T detectionScale, const Point& newPos, T newScale) const
+        {
+            if (xtf == 0 || !isSameScale(newScale, detectionScale))
+                return 0;
+
+            T cellSize = detectionScale * _CELL_SIZE;
+            cv::Point_<T> shift((newPos.x - detectionPos.x) / cellSize,
+                (newPos.y - detectionPos.y) / cellSize);
+
+            if (std::abs(shift.x) > _MAX_REUSE_SHIFT || std::abs(shift.y) > _MAX_REUSE_SHIFT)
+                return 0;
+
+            if (shift.x == 0 && shift.y == 0)
+                return xtf;
+
+            cv::Mat shiftf = circularShiftSpectrum<T>(xtf->channels[0].size(), shift,
+                _USE_CCS ? 0 : cv::DFT_COMPLEX_OUTPUT);
+
+            return DFC::mulSpectrumsFeatures(shiftf, xtf, false);
+        }
+
     private:
-        typedef void(*cvFhogPtr)
-            (const cv::Mat& img, std::shared_ptr<DFC>& cvFeatures, int binSize, int fhogChannelsToCopy);
-        cvFhogPtr cvFhog = 0;
+        FE _extractor;
+        UpdateScheduler<T> _updateScheduler;
 
         typedef void(*dftPtr)
             (const cv::Mat& input, cv::Mat& output, int flags);
@@ -671,6 +940,9 @@ namespace cf_tracking
         cv::Mat _cosWindow;
         cv::Mat _y;
         std::shared_ptr<DFC> _hfNumerator;
+        std::shared_ptr<DFC> _xtTemplate;
+        std::shared_ptr<FDFC> _hfNumeratorCompressed;
+        cv::Mat _projection;
         cv::Mat _hfDenominator;
         cv::Mat _yf;
         Point _pos;
@@ -681,6 +953,10 @@ namespace cf_tracking
         T _scale; // _scale is the scale of the template; not the target
         T _templateScaleFactor; // _templateScaleFactor is used to calc the target scale
         ScaleEstimator<T>* _scaleEstimator;
+        ScaleEstimatorParas<T> _scaleParas;
+        // target size the scale filter was initialized with
+        Size _scaleTargetSize;
+        std::shared_ptr<FeatureCache> _featureCache;
         int _frameIdx = 1;
         bool _isInitialized;
 
@@ -692,6 +968,7 @@ namespace cf_tracking
         const T _LEARNING_RATE;
         const T _PSR_THRESHOLD;
         const int _PSR_PEAK_DEL;
+        const int _PSR_STRIDE;
         const int _CELL_SIZE;
         const int _TEMPLATE_SIZE;
         const std::string _ID;
@@ -699,9 +976,14 @@ namespace cf_tracking
         const int _RESIZE_TYPE;
         const bool _ORIGINAL_VERSION;
         const bool _USE_CCS;
+        const bool _REUSE_DETECTION_FEATURES;
+        const T _MAX_REUSE_SHIFT;
+        const bool _FAST_MODE;
 
         DsstDebug<T>* _debug;
     };
+
+    typedef DsstTracker_<DsstFeatureExtractor> DsstTracker;
 }
 
 #endif /* KCF_TRACKER_H_ */
@@ -44,6 +44,11 @@ filter update scheme [2] used by Henriques, et al. in the VOT Challenge 2014.
 As default scale adaption, the tracker uses the 1D scale filter
 presented in [3]. The scale filter can be found in scale_estimator.hpp.
 Additionally, target loss detection is implemented according to [4].
+Model updates can be skipped while the response is stable; see
+update_scheduler.hpp.
+
+The features are computed by the extractor given as template argument;
+see feature_extractors.hpp. KcfTracker uses the original FHOG features.
 
 Every complex matrix is as default in CCS packed form:
 see : https://software.intel.com/en-us/node/504243
@@ -75,21 +80,35 @@ in Proc. CVPR, 2010.
 #include <opencv2/core/core.hpp>
 #include <iostream>
 #include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
 
 #include "cv_ext.hpp"
 #include "feature_channels.hpp"
+#include "feature_extractors.hpp"
 #include "gradientMex.hpp"
 #include "mat_consts.hpp"
 #include "math_helper.hpp"
 #include "cf_tracker.hpp"
 #include "kcf_debug.hpp"
 #include "scale_estimator.hpp"
+#include "update_scheduler.hpp"
 #include "psr.hpp"
 
 namespace cf_tracking
 {
     struct KcfParameters
     {
+        // kernels proposed in [1]; the linear kernel
+        // corresponds to the DCF and is the fastest
+        enum KernelType
+        {
+            GAUSSIAN_KERNEL = 0,
+            POLYNOMIAL_KERNEL = 1,
+            LINEAR_KERNEL = 2
+        };
+
         double padding = 1.7;
         double lambda = 0.0001;
         double outputSigmaFactor = 0.05;
@@ -97,7 +116,10 @@ namespace cf_tracking
         double votScaleWeight = 0.95;
         int templateSize = 100;
         double interpFactor = 0.012;
+        int kernelType = GAUSSIAN_KERNEL;
         double kernelSigma = 0.6;
+        double polynomialAdditive = 1.0;
+        double polynomialExponent = 9.0;
         int cellSize = 4;
         int pixelPadding = 0;
 
@@ -113,25 +135,47 @@ namespace cf_tracking
         int scaleCellSize = 4;
         int numberOfScales = 33;
 
+        // build the training sample by shifting the spectrum of the
+        // detection sample instead of extracting features at the new
+        // position; only used if the scale did not change and the
+        // displacement is at most maxReuseShift cells
+        bool reuseDetectionFeatures = false;
+        double maxReuseShift = 1.0;
+
+        // update the translation and scale filters only every
+        // translationUpdateInterval and scaleUpdateInterval frames
+        // while the PSR is at least stableUpdatePsr; see UpdateScheduler
+        int translationUpdateInterval = 1;
+        int scaleUpdateInterval = 1;
+        double stableUpdatePsr = 20.0;
+        bool compensateSkippedUpdates = true;
+
+        // required if the tracker uses ColorNamesFeatureExtractor
+        std::shared_ptr<const cv::Mat> colorNamesTable;
+
         // testing
         int resizeType = cv::INTER_LINEAR;
         bool useFhogTranspose = false;
     };
 
-    class KcfTracker : public CfTracker
+    template<template<class> class FEATURES>
+    class KcfTracker_ : public CfTracker
     {
     public:
-        static const int NUM_FEATURE_CHANNELS = 31;
         typedef double T; // set precision here: double or float
         static const int CV_TYPE = cv::DataType<T>::type;
         typedef cv::Size_<T> Size;
-        typedef FhogFeatureChannels<T> FFC;
+        typedef FEATURES<T> FE;
+        typedef typename FE::FC FFC;
+        static const int NUM_FEATURE_CHANNELS = FE::NUMBER_OF_CHANNELS;
         typedef mat_consts::constants<T> consts;
         typedef cv::Point_<T> Point;
         typedef cv::Rect_<T> Rect;
 
-        KcfTracker(KcfParameters paras, KcfDebug<T>* debug = 0)
-            : _isInitialized(false),
+        KcfTracker_(KcfParameters paras, KcfDebug<T>* debug = 0)
+            : _extractor(getExtractorParas(paras)),
+            _updateScheduler(getSchedulerParas(paras)),
+            _isInitialized(false),
             _PADDING(static_cast<T>(paras.padding)),
             _LAMBDA(static_cast<T>(paras.lambda)),
             _OUTPUT_SIGMA_FACTOR(static_cast<T>(paras.outputSigmaFactor)),
@@ -140,6 +184,8 @@ namespace cf_tracking
             _TEMPLATE_SIZE(paras.templateSize),
             _INTERP_FACTOR(static_cast<T>(paras.interpFactor)),
             _KERNEL_SIGMA(static_cast<T>(paras.kernelSigma)),
+            _POLYNOMIAL_ADDITIVE(static_cast<T>(paras.polynomialAdditive)),
+            _POLYNOMIAL_EXPONENT(static_cast<T>(paras.polynomialExponent)),
             _CELL_SIZE(paras.cellSize),
             _PIXEL_PADDING(paras.pixelPadding),
             _N_SCALES_VOT(3),
@@ -152,10 +198,17 @@ namespace cf_tracking
             _RESIZE_TYPE(paras.resizeType),
             _ID("KCFcpp"),
             _USE_CCS(true),
+            _REUSE_DETECTION_FEATURES(paras.reuseDetectionFeatures),
+            _MAX_REUSE_SHIFT(static_cast<T>(paras.maxReuseShift)),
             _scaleEstimator(0),
             _debug(debug)
         {
-            correlate = &KcfTracker::gaussianCorrelation;
+            if (paras.kernelType == KcfParameters::LINEAR_KERNEL)
+                correlate = &KcfTracker_::linearCorrelation;
+            else if (paras.kernelType == KcfParameters::POLYNOMIAL_KERNEL)
+                correlate = &KcfTracker_::polynomialCorrelation;
+            else
+                correlate = &KcfTracker_::gaussianCorrelation;
 
             if (paras.useDsstScaleEstimation)
             {
@@ -167,6 +220,7 @@ namespace cf_tracking
                 sp.lambda = static_cast<T>(paras.scaleLambda);
                 sp.learningRate = static_cast<T>(paras.interpFactor);
                 sp.useFhogTranspose = paras.useFhogTranspose;
+                _scaleParas = sp;
                 _scaleEstimator = new ScaleEstimator<T>(sp);
             }
 
@@ -174,11 +228,6 @@ namespace cf_tracking
             cv::Mat initDft = (cv::Mat_<T>(1, 1) << 1);
             dft(initDft, initDft);
 
-            if (paras.useFhogTranspose)
-                cvFhog = &piotr::cvFhogT < T, FFC > ;
-            else
-                cvFhog = &piotr::cvFhog < T, FFC > ;
-
             if (_debug != 0)
             {
                 if (CV_MAJOR_VERSION < 3)
@@ -189,7 +238,7 @@ namespace cf_tracking
             }
         }
 
-        virtual ~KcfTracker()
+        virtual ~KcfTracker_()
         {
             delete _scaleEstimator;
         }
@@ -366,6 +415,22 @@ namespace cf_tracking
             return _ID;
         }
 
+        virtual int getNumberOfScales()
+        {
+            return _scaleEstimator ? _scaleParas.numberOfScales : 0;
+        }
+
+        virtual void setNumberOfScales(int numberOfScales)
+        {
+            if (_scaleEstimator == 0 || numberOfScales < 1
+                || numberOfScales == _scaleParas.numberOfScales)
+                return;
+
+            _scaleParas.numberOfScales = numberOfScales;
+            delete _scaleEstimator;
+            _scaleEstimator = new ScaleEstimator<T>(_scaleParas);
+        }
+
     private:
         bool reinit_(const cv::Mat& image, Rect& boundingBox)
         {
@@ -378,6 +443,7 @@ namespace cf_tracking
 
             // original target size for scale estimation
             Size targetSize = Size(boundingBox.width, boundingBox.height);
+            _scaleTargetSize = targetSize;
 
             _targetSize = targetSize;
             T targetPadding = _PADDING * sqrt(_targetSize.width * _targetSize.height);
@@ -447,22 +513,27 @@ namespace cf_tracking
                     return false;
             }
 
+            _updateScheduler.reset();
             _isInitialized = true;
             return true;
         }
 
+        // xf is only extracted at _pos and _scale if it is not set
         bool getTrainingData(const cv::Mat& image, cv::Mat& numeratorf,
             cv::Mat& denominatorf, std::shared_ptr<FFC>& xf)
         {
-            std::shared_ptr<FFC> features(0);
+            if (xf == 0)
+            {
+                std::shared_ptr<FFC> features(0);
 
-            if (getFeatures(image, _pos, _scale, features) == false)
-                return false;
+                if (getFeatures(image, _pos, _scale, features) == false)
+                    return false;
 
-            if (_USE_CCS)
-                xf = FFC::dftFeatures(features);
-            else
-                xf = FFC::dftFeatures(features, cv::DFT_COMPLEX_OUTPUT);
+                if (_USE_CCS)
+                    xf = FFC::dftFeatures(features);
+                else
+                    xf = FFC::dftFeatures(features, cv::DFT_COMPLEX_OUTPUT);
+            }
 
             cv::Mat kf = (this->*correlate)(xf, xf);
 
@@ -520,6 +591,48 @@ namespace cf_tracking
             return kf;
         }
 
+        cv::Mat polynomialCorrelation(const std::shared_ptr<FFC>& xf, const std::shared_ptr<FFC>& yf) const
+        {
+            std::shared_ptr<FFC> xyf = FFC::mulSpectrumsFeatures(xf, yf, true);
+            std::shared_ptr<FFC> realXy = FFC::idftFeatures(xyf);
+            cv::Mat xy = FFC::sumFeaturesInPlace(realXy);
+
+            T numel = static_cast<T>(xf->channels[0].total() * NUM_FEATURE_CHANNELS);
+            calcPolynomialTerm(xy, numel);
+            cv::Mat kf;
+
+            if (_USE_CCS)
+                dft(xy, kf);
+            else
+                dft(xy, kf, cv::DFT_COMPLEX_OUTPUT);
+
+            return kf;
+        }
+
+        // the linear kernel stays in the frequency domain;
+        // summing the channels' spectra equals summing them spatially
+        cv::Mat linearCorrelation(const std::shared_ptr<FFC>& xf, const std::shared_ptr<FFC>& yf) const
+        {
+            std::shared_ptr<FFC> xyf = FFC::mulSpectrumsFeatures(xf, yf, true);
+            cv::Mat kf = FFC::sumFeaturesInPlace(xyf);
+
+            T numel = static_cast<T>(xf->channels[0].total() * NUM_FEATURE_CHANNELS);
+            kf *= 1 / numel;
+            return kf;
+        }
+
+        void calcPolynomialTerm(cv::Mat& xy, T numel) const
+        {
+            CV_Assert(xy.isContinuous());
+
+            T* xyd = xy.ptr<T>(0);
+            const int total = static_cast<int>(xy.total());
+            const T fraction = 1 / numel;
+
+            for (int i = 0; i < total; ++i)
+                xyd[i] = std::pow(xyd[i] * fraction + _POLYNOMIAL_ADDITIVE, _POLYNOMIAL_EXPONENT);
+        }
+
         void calcGaussianTerm(cv::Mat& xy, T numel, T xx, T yy) const
         {
             int width = xy.cols;
@@ -557,31 +670,26 @@ namespace cf_tracking
             }
         }
 
+        // if patchOut is set, it receives the resized patch
+        // instead of showing it in the debug output
         bool getFeatures(const cv::Mat& image, const Point& pos,
-            const T scale, std::shared_ptr<FFC>& features) const
+            const T scale, std::shared_ptr<FFC>& features, cv::Mat* patchOut = 0) const
         {
-            cv::Mat patch;
+            cv::Mat patchResized;
             Size patchSize = _templateSz * scale;
 
-            if (getSubWindow<T>(image, patch, patchSize, pos) == false)
+            // sampled directly from the image; the cosine window
+            // is applied while the features are written
+            if (sampleSubWindow<T>(image, patchResized, patchSize, pos,
+                cv::Size(_templateSz), _RESIZE_TYPE) == false)
                 return false;
 
-            cv::Mat patchResized;
-            resize(patch, patchResized, _templateSz, 0, 0, _RESIZE_TYPE);
-
-            cv::Mat patchResizedFloat;
-            patchResized.convertTo(patchResizedFloat, CV_32FC(3));
-
-            if (_debug != 0)
-            {
+            if (patchOut != 0)
+                *patchOut = patchResized;
+            else if (_debug != 0)
                 _debug->showPatch(patchResized);
-            }
-
-            patchResizedFloat *= 0.003921568627451; // patchResizedFloat /= 255;
 
-            features.reset(new FFC());
-            piotr::cvFhog<T, FFC>(patchResizedFloat, features, _CELL_SIZE);
-            FFC::mulFeatures(features, _cosWindow);
+            _extractor.extract(patchResized, _CELL_SIZE, features, _cosWindow);
 
             return true;
         }
@@ -620,13 +728,16 @@ namespace cf_tracking
 
             T newScale = oldScale;
             Point newPos = oldPos;
-            cv::Point2i maxResponseIdx;
+            ResponseAnalysis<T> analysis;
             cv::Mat response;
+            std::shared_ptr<FFC> detectionZf(0);
+            T detectionScale = oldScale;
 
             // in case of error return the last box
             boundingBox = _lastBoundingBox;
 
-            if (detectModel(image, response, maxResponseIdx, newPos, newScale) == false)
+            if (detectModel(image, response, analysis, newPos, newScale,
+                detectionZf, detectionScale) == false)
                 return false;
 
             // calc new box
@@ -638,12 +749,23 @@ namespace cf_tracking
 
             if (_ENABLE_TRACKING_LOSS_DETECTION)
             {
-                if (evalReponse(image, response, maxResponseIdx,
+                if (evalReponse(image, response, analysis,
                     tempBoundingBox) == false)
                     return false;
             }
 
-            if (updateModel(image, newPos, newScale) == false)
+            int translationFrames = 0;
+            int scaleFrames = 0;
+            _updateScheduler.nextFrame(analysis.psr());
+            _updateScheduler.scheduleTranslation(translationFrames);
+            _updateScheduler.scheduleScale(scaleFrames);
+
+            std::shared_ptr<FFC> xf(0);
+
+            if (_REUSE_DETECTION_FEATURES && translationFrames > 0)
+                xf = shiftDetectionSpectrum(detectionZf, oldPos, detectionScale, newPos, newScale);
+
+            if (updateModel(image, newPos, newScale, xf, translationFrames, scaleFrames) == false)
                 return false;
 
             boundingBox &= Rect(0, 0, static_cast<T>(image.cols), static_cast<T>(image.rows));
@@ -653,15 +775,20 @@ namespace cf_tracking
         }
 
         bool evalReponse(const cv::Mat &image, const cv::Mat& response,
-            const cv::Point2i& maxResponseIdx,
+            const ResponseAnalysis<T>& analysis,
             const Rect& tempBoundingBox) const
         {
-            T peakValue = 0;
-            T psrClamped = calcPsr(response, maxResponseIdx, _PSR_PEAK_DEL, peakValue);
+            T psrClamped = analysis.psr();
 
             if (_debug)
             {
-                _debug->showResponse(response, peakValue);
+                // shift max response to the middle for display
+                cv::Mat shiftedResponse;
+                cv::Point2f delta(static_cast<float>(floor(_yf.cols * 0.5) + 1),
+                    static_cast<float>(floor(_yf.rows * 0.5) + 1));
+
+                shift(response, shiftedResponse, delta, cv::BORDER_WRAP);
+                _debug->showResponse(shiftedResponse, analysis.peakValue);
                 _debug->setPsr(psrClamped);
             }
 
@@ -682,26 +809,27 @@ namespace cf_tracking
             return true;
         }
 
-        bool detectModel(const cv::Mat& image, cv::Mat& response, cv::Point2i& maxResponseIdx,
-            Point& newPos, T& newScale) const
+        bool detectModel(const cv::Mat& image, cv::Mat& response, ResponseAnalysis<T>& analysis,
+            Point& newPos, T& newScale, std::shared_ptr<FFC>& detectionZf, T& detectionScale) const
         {
-            double newMaxResponse;
-
             if (_scaleEstimator || !_USE_VOT_SCALE_ESTIMATION)
             {
                 if (getResponse(image, newPos,
-                    newScale, response, newMaxResponse,
-                    maxResponseIdx) == false)
+                    newScale, response, analysis,
+                    &detectionZf) == false)
                     return false;
             }
             else
             {
                 if (detectScales(image, newPos,
-                    response, maxResponseIdx, newScale) == false)
+                    response, analysis, newScale, &detectionZf) == false)
                     return false;
             }
 
-            cv::Point_<T> subDelta = subPixelDelta<T>(response, maxResponseIdx);
+            detectionScale = newScale;
+
+            cv::Point_<T> subDelta = subPixelDelta<T>(analysis.peakIdx,
+                analysis.vNeighbors, analysis.hNeighbors);
             if (subDelta.y >= response.rows / 2)
                 subDelta.y -= response.rows;
 
@@ -722,7 +850,7 @@ namespace cf_tracking
                 newPos.y += _scale * posDeltaY;
             }
 
-            if (_scaleEstimator)
+            if (_scaleEstimator && _scaleEstimator->isInitialized())
             {
                 //find scale
                 T tempScale = newScale * _templateScaleFactor;
@@ -734,126 +862,185 @@ namespace cf_tracking
                 newScale = tempScale / _templateScaleFactor;
             }
 
-            // shift max response to the middle to ease PSR extraction
-            cv::Point2f delta(static_cast<float>(floor(_yf.cols * 0.5) + 1),
-                static_cast<float>(floor(_yf.rows * 0.5) + 1));
-
-            shift(response, response, delta, cv::BORDER_WRAP);
-
-            maxResponseIdx.x = mod(static_cast<int>(delta.x) + maxResponseIdx.x, _yf.cols);
-            maxResponseIdx.y = mod(static_cast<int>(delta.y) + maxResponseIdx.y, _yf.rows);
-
             return true;
         }
 
+        // the spectrum of the training sample is extracted
+        // at newPos and newScale if xf is not set; translationFrames
+        // and scaleFrames are the number of frames covered by the
+        // update of the filters; a filter is not updated if it is 0
         bool updateModel(const cv::Mat& image, const Point& newPos,
-            const T& newScale)
+            const T& newScale, std::shared_ptr<FFC> xf = 0,
+            int translationFrames = 1, int scaleFrames = 1)
         {
             _scale = newScale;
             _pos = newPos;
-            cv::Mat numerator;
-            cv::Mat denominator;
-            std::shared_ptr<FFC> xf(0);
 
-            if (getTrainingData(image, numerator, denominator, xf) == false)
-                return false;
+            if (translationFrames > 0)
+            {
+                const T interpFactor = compensatedLearningRate(_INTERP_FACTOR, translationFrames);
+                cv::Mat numerator;
+                cv::Mat denominator;
 
-            _modelNumeratorf = (1 - _INTERP_FACTOR) * _modelNumeratorf + _INTERP_FACTOR * numerator;
-            _modelDenominatorf = (1 - _INTERP_FACTOR) * _modelDenominatorf + _INTERP_FACTOR * denominator;
-            FFC::mulValueFeatures(_modelXf, (1 - _INTERP_FACTOR));
-            FFC::mulValueFeatures(xf, _INTERP_FACTOR);
-            FFC::addFeatures(_modelXf, xf);
-            cv::Mat alphaf;
+                if (getTrainingData(image, numerator, denominator, xf) == false)
+                    return false;
 
-            if (_USE_CCS)
-                divSpectrums(_modelNumeratorf, _modelDenominatorf, alphaf);
-            else
-                divideSpectrumsNoCcs<T>(_modelNumeratorf, _modelDenominatorf, alphaf);
+                _modelNumeratorf = (1 - interpFactor) * _modelNumeratorf + interpFactor * numerator;
+                _modelDenominatorf = (1 - interpFactor) * _modelDenominatorf + interpFactor * denominator;
+                FFC::mulValueFeatures(_modelXf, (1 - interpFactor));
+                FFC::mulValueFeatures(xf, interpFactor);
+                FFC::addFeatures(_modelXf, xf);
+                cv::Mat alphaf;
 
-            _modelAlphaf = alphaf;
+                if (_USE_CCS)
+                    divSpectrums(_modelNumeratorf, _modelDenominatorf, alphaf);
+                else
+                    divideSpectrumsNoCcs<T>(_modelNumeratorf, _modelDenominatorf, alphaf);
 
-            if (_scaleEstimator)
+                _modelAlphaf = alphaf;
+            }
+
+            if (_scaleEstimator && !_scaleEstimator->isInitialized())
+            {
+                // the scale filter was rebuilt by setNumberOfScales
+                if (_scaleEstimator->reinit(image, newPos, _scaleTargetSize,
+                    newScale * _templateScaleFactor) == false)
+                    return false;
+            }
+            else if (_scaleEstimator && scaleFrames > 0)
             {
-                if (_scaleEstimator->updateScale(image, newPos, newScale * _templateScaleFactor) == false)
+                if (_scaleEstimator->updateScale(image, newPos,
+                    newScale * _templateScaleFactor, scaleFrames) == false)
                     return false;
             }
 
             return true;
         }
 
-        bool detectScales(const cv::Mat& image, const Point& pos,
-            cv::Mat& response, cv::Point2i& maxResponseIdx, T& scale) const
+        // spectrum of the training sample at newPos obtained by circularly
+        // shifting the spectrum of the detection sample; the cosine window
+        // moves with the sample, hence this is only an approximation for
+        // small displacements; returns 0 if features have to be extracted
+        std::shared_ptr<FFC> shiftDetectionSpectrum(const std::shared_ptr<FFC>& zf,
+            const Point& detectionPos, T detectionScale, const Point& newPos, T newScale) const
         {
-            double maxResponse = 0;
+            if (zf == 0 || !isSameScale(newScale, detectionScale))
+                return 0;
 
-            cv::Mat* newResponses = new cv::Mat[_N_SCALES_VOT];
-            cv::Point2i* newMaxIdxs = new cv::Point2i[_N_SCALES_VOT];
-            double* newMaxResponses = new double[_N_SCALES_VOT]{};
-            bool* validResults = new bool[_N_SCALES_VOT]{};
-            T* newScales = new T[_N_SCALES_VOT]{};
+            T cellSize = detectionScale * _CELL_SIZE;
+            cv::Point_<T> shift((newPos.x - detectionPos.x) / cellSize,
+                (newPos.y - detectionPos.y) / cellSize);
 
-            for (int i = 0; i < _N_SCALES_VOT; ++i)
-                newScales[i] = scale * _scaleFactors.at<T>(0, i);
+            if (std::abs(shift.x) > _MAX_REUSE_SHIFT || std::abs(shift.y) > _MAX_REUSE_SHIFT)
+                return 0;
 
-#pragma omp parallel for
-            for (int i = 0; i < _N_SCALES_VOT; ++i)
-                validResults[i] = getResponse(image, pos,
-                newScales[i], newResponses[i], newMaxResponses[i], newMaxIdxs[i]);
+            if (shift.x == 0 && shift.y == 0)
+                return zf;
+
+            cv::Mat shiftf = circularShiftSpectrum<T>(zf->channels[0].size(), shift,
+                _USE_CCS ? 0 : cv::DFT_COMPLEX_OUTPUT);
+
+            return FFC::mulSpectrumsFeatures(shiftf, zf, false);
+        }
+
+        // workspace of one scale hypothesis of detectScales
+        struct ScaleHypothesis
+        {
+            cv::Mat response;
+            ResponseAnalysis<T> analysis;
+            bool isValid = false;
+            T scale = 0;
+            std::shared_ptr<FFC> zf;
+            cv::Mat patch; // only kept for debug output
+        };
 
-            bool validFound = false;
+        bool detectScales(const cv::Mat& image, const Point& pos,
+            cv::Mat& response, ResponseAnalysis<T>& analysis, T& scale,
+            std::shared_ptr<FFC>* zf = 0) const
+        {
+            std::vector<ScaleHypothesis> hypotheses(_N_SCALES_VOT);
 
             for (int i = 0; i < _N_SCALES_VOT; ++i)
-                validFound |= validResults[i];
+                hypotheses[i].scale = scale * _scaleFactors.at<T>(0, i);
 
-            if (validFound == false)
-                return false;
+            // every hypothesis only writes to its own workspace;
+            // debug output is not thread safe and done afterwards
+#pragma omp parallel for
+            for (int i = 0; i < _N_SCALES_VOT; ++i)
+            {
+                ScaleHypothesis& h = hypotheses[i];
+                h.isValid = getResponse(image, pos, h.scale, h.response,
+                    h.analysis, zf ? &h.zf : 0, _debug ? &h.patch : 0);
+            }
 
+            // the reduction is done serially in scale order and
+            // thus does not depend on the thread scheduling;
+            // the middle scale is preferred on ties
             int bestIdx = static_cast<int>(floor(_N_SCALES_VOT / 2.0));
-            maxResponse = newMaxResponses[bestIdx];
+            double maxResponse = hypotheses[bestIdx].analysis.peakValue;
+
+            if (hypotheses[bestIdx].isValid == false)
+            {
+                bestIdx = -1;
+                maxResponse = -std::numeric_limits<double>::max();
+            }
 
             for (int i = 0; i < _N_SCALES_VOT; ++i)
             {
-                if (validResults[i] &&
-                    newMaxResponses[i] * _SCALE_WEIGHT > maxResponse)
+                if (hypotheses[i].isValid &&
+                    (bestIdx < 0 || hypotheses[i].analysis.peakValue * _SCALE_WEIGHT > maxResponse))
                 {
-                    maxResponse = newMaxResponses[i];
+                    maxResponse = hypotheses[i].analysis.peakValue;
                     bestIdx = i;
                 }
             }
 
-            response = newResponses[bestIdx];
-            maxResponseIdx = newMaxIdxs[bestIdx];
-            scale = newScales[bestIdx];
+            if (bestIdx < 0)
+                return false;
+
+            const ScaleHypothesis& best = hypotheses[bestIdx];
+            response = best.response;
+            analysis = best.analysis;
+
+            if (zf)
+                *zf = best.zf;
+
+            if (_debug != 0)
+                _debug->showPatch(best.patch);
+
+            scale = best.scale;
             scale = std::max(_VOT_MIN_SCALE_FACTOR, scale);
             scale = std::min(_VOT_MAX_SCALE_FACTOR, scale);
 
-            delete[] newResponses;
-            delete[] newMaxIdxs;
-            delete[] newMaxResponses;
-            delete[] validResults;
-            delete[] newScales;
-
             return true;
         }
 
         bool getResponse(const cv::Mat& image, const Point& pos,
-            T scale, cv::Mat &newResponse, double& newMaxResponse,
-            cv::Point2i& newMaxIdx) const
+            T scale, cv::Mat &newResponse, ResponseAnalysis<T>& analysis,
+            std::shared_ptr<FFC>* zf = 0, cv::Mat* patchOut = 0) const
         {
-            if (detect(image, pos, scale, newResponse) == false)
+            if (detect(image, pos, scale, newResponse, zf, patchOut) == false)
                 return false;
 
-            minMaxLoc(newResponse, 0, &newMaxResponse, 0, &newMaxIdx);
+            // the peak of a centered target is at (0, 0); the peak window
+            // is clipped as on the response shifted to center that peak
+            cv::Point2i origin(static_cast<int>(floor(_yf.cols * 0.5) + 1),
+                static_cast<int>(floor(_yf.rows * 0.5) + 1));
+
+            analyzeResponse(newResponse, _PSR_PEAK_DEL, origin, analysis);
 
             return true;
         }
 
+        // zfOut receives the spectrum of the detection sample if set;
+        // see getFeatures for patchOut
         bool detect(const cv::Mat& image, const Point& pos,
-            T scale, cv::Mat& response) const
+            T scale, cv::Mat& response, std::shared_ptr<FFC>* zfOut = 0,
+            cv::Mat* patchOut = 0) const
         {
             std::shared_ptr<FFC> features(0);
 
-            if (getFeatures(image, pos, scale, features) == false)
+            if (getFeatures(image, pos, scale, features, patchOut) == false)
                 return false;
 
             std::shared_ptr<FFC> zf;
@@ -866,21 +1053,43 @@ namespace cf_tracking
             cv::Mat responsef;
             mulSpectrums(_modelAlphaf, kzf, responsef, 0, false);
             idft(responsef, response, cv::DFT_REAL_OUTPUT | cv::DFT_SCALE);
+
+            if (zfOut)
+                *zfOut = zf;
+
             return true;
         }
 
     private:
-        KcfTracker& operator=(const KcfTracker&)
+        KcfTracker_& operator=(const KcfTracker_&)
         {}
 
+        static FeatureExtractorParameters getExtractorParas(const KcfParameters& paras)
+        {
+            FeatureExtractorParameters fp;
+            fp.useFhogTranspose = paras.useFhogTranspose;
+            fp.resizeType = paras.resizeType;
+            fp.colorNamesTable = paras.colorNamesTable;
+            return fp;
+        }
+
+        static UpdateSchedulerParas getSchedulerParas(const KcfParameters& paras)
+        {
+            UpdateSchedulerParas up;
+            up.translationInterval = paras.translationUpdateInterval;
+            up.scaleInterval = paras.scaleUpdateInterval;
+            up.stablePsr = paras.stableUpdatePsr;
+            up.compensateLearningRate = paras.compensateSkippedUpdates;
+            return up;
+        }
+
     private:
-        typedef cv::Mat(KcfTracker::*correlatePtr)(const std::shared_ptr<FFC>&,
+        typedef cv::Mat(KcfTracker_::*correlatePtr)(const std::shared_ptr<FFC>&,
             const std::shared_ptr<FFC>&) const;
         correlatePtr correlate = 0;
 
-        typedef void(*cvFhogPtr)
-            (const cv::Mat& img, std::shared_ptr<FFC>& cvFeatures, int binSize, int fhogChannelsToCopy);
-        cvFhogPtr cvFhog = 0;
+        FE _extractor;
+        UpdateScheduler<T> _updateScheduler;
 
         cv::Mat _cosWindow;
         cv::Mat _y;
@@ -899,6 +1108,9 @@ namespace cf_tracking
         int _frameIdx = 1;
         bool _isInitialized;
         ScaleEstimator<T>* _scaleEstimator;
+        ScaleEstimatorParas<T> _scaleParas;
+        // target size the scale filter was initialized with
+        Size _scaleTargetSize;
 
         const double _MIN_AREA;
         const double _MAX_AREA_FACTOR;
@@ -909,6 +1121,8 @@ namespace cf_tracking
         const T _SCALE_WEIGHT;
         const T _INTERP_FACTOR;
         const T _KERNEL_SIGMA;
+        const T _POLYNOMIAL_ADDITIVE;
+        const T _POLYNOMIAL_EXPONENT;
         const T _PSR_THRESHOLD;
         const int _TEMPLATE_SIZE;
         const int _PSR_PEAK_DEL;
@@ -920,12 +1134,16 @@ namespace cf_tracking
         const bool _USE_VOT_SCALE_ESTIMATION;
         const bool _ENABLE_TRACKING_LOSS_DETECTION;
         const bool _USE_CCS;
+        const bool _REUSE_DETECTION_FEATURES;
+        const T _MAX_REUSE_SHIFT;
         // it should be possible to find more reasonable values for min/max scale; application dependent
         T _VOT_MIN_SCALE_FACTOR = static_cast<T>(0.01);
         T _VOT_MAX_SCALE_FACTOR = static_cast<T>(40);
 
         KcfDebug<T>* _debug;
     };
+
+    typedef KcfTracker_<FhogFeatureExtractor> KcfTracker;
 }
 
 #endif /* KCF_TRACKER_H_ */
@@ -72,6 +72,8 @@ public:
             "for psr calculation around the peak (1 means that a window of 3 by 3 is deleted; 0 means"
             "that max response is deleted; 2 * peak_del + 1 pixels are deleted)",
             false, paras.psrPeakDel, "integer", cmd);
+        TCLAP::SwitchArg enableFastMode("", "para_fast_mode", "Enable the fast DSST mode (PCA compressed features, "
+            "coarser translation grid and interpolated scale responses)!", cmd, paras.enableFastMode);
 
         cmd.parse(argc, argv);
 
@@ -89,6 +91,7 @@ public:
         paras.psrPeakDel = psrPeakDel.getValue();
         paras.templateSize = templateSize.getValue();
         paras.enableTrackingLossDetection = enableTrackingLossDetection.getValue();
+        paras.enableFastMode = enableFastMode.getValue();
 
         // use original paper parameters from
         // Danelljan, Martin, et al., "Accurate scale estimation for robust visual tracking," in Proc. BMVC, 2014
@@ -28,6 +28,8 @@
 
 #include <algorithm>
 
+#include<opencv2/imgproc/imgproc.hpp>
+
 #include "TLDUtil.h"
 
 using namespace cv;
@@ -53,6 +55,11 @@ namespace tld
 
         numTrees = 10;
         numFeatures = 13;
+        pyramidLevels = 1;
+        pyramidMinSize = 60;
+
+        numLevels = 1;
+        scaleLevels = NULL;
 
         initialised = false;
 
@@ -102,6 +109,8 @@ namespace tld
         ensembleClassifier->imgWidthStep = imgWidthStep;
         ensembleClassifier->numScales = numScales;
         ensembleClassifier->scales = scales;
+        ensembleClassifier->scaleLevels = scaleLevels;
+        ensembleClassifier->levelWidthSteps = levelWidthSteps;
         ensembleClassifier->numFeatures = numFeatures;
         ensembleClassifier->numTrees = numTrees;
         nnClassifier->windows = windows;
@@ -133,6 +142,9 @@ namespace tld
 
         delete[] scales;
         scales = NULL;
+        delete[] scaleLevels;
+        scaleLevels = NULL;
+        numLevels = 1;
         delete[] windows;
         windows = NULL;
         delete[] windowOffsets;
@@ -164,6 +176,8 @@ namespace tld
         int windowIndex = 0;
 
         scales = new Size[maxScale - minScale + 1]{};
+        scaleLevels = new int[maxScale - minScale + 1]{};
+        numLevels = 1;
 
         numWindows = 0;
 
@@ -194,6 +208,15 @@ namespace tld
             scales[scaleIndex].width = w;
             scales[scaleIndex].height = h;
 
+            //Large windows are evaluated on a downsampled level, which is cheaper for the NN patches and the fern lookups
+            int level = 0;
+
+            while (level + 1 < pyramidLevels && (min(w, h) >> (level + 1)) >= max(pyramidMinSize, 1))
+                level++;
+
+            scaleLevels[scaleIndex] = level;
+            numLevels = max(numLevels, level + 1);
+
             scaleIndex++;
 
             numWindows += static_cast<int>(floor((float)(scanAreaW - w + ssw) / ssw) * floor((float)(scanAreaH - h + ssh) / ssh));
@@ -235,6 +258,12 @@ namespace tld
         }
 
         assert(windowIndex == numWindows);
+
+        //The levels are continuous images of exactly half the size of the previous level
+        levelWidthSteps.assign(numLevels, imgWidthStep);
+
+        for (int level = 1; level < numLevels; level++)
+            levelWidthSteps[level] = imgWidth >> level;
     }
 
     //Creates offsets that can be added to bounding boxes
@@ -256,12 +285,29 @@ namespace tld
             *off++ = sub2idx(window[0] + window[2] - 1, window[1] + window[3] - 1, imgWidthStep); // x2,y2
             *off++ = window[4] * 2 * numFeatures * numTrees; // pointer to features for this scale
             *off++ = window[2] * window[3]; //Area of bounding box
+
+            int level = scaleLevels[window[4]];
+
+            if (level == 0)
+                *off++ = sub2idx(window[0] - 1, window[1] - 1, imgWidthStep); // x1-1,y1-1
+            else
+                *off++ = sub2idx(window[0] >> level, window[1] >> level, levelWidthSteps[level]); // x1,y1 on the level
+
+            *off++ = level;
         }
     }
 
     void DetectorCascade::detect(const Mat &img)
+    {
+        PreprocessedFrame frame;
+        frame.gray = img;
+        detect(frame);
+    }
+
+    void DetectorCascade::detect(const PreprocessedFrame &frame)
     {
         //For every bounding box, the output is confidence, pattern, variance
+        const Mat &img = frame.gray;
 
         detectionResult->reset();
 
@@ -271,8 +317,13 @@ namespace tld
         }
 
         //Prepare components
-        varianceFilter->nextIteration(img); //Calculates integral images
-        ensembleClassifier->nextIteration(img);
+        if (frame.hasIntegralImages())
+            varianceFilter->nextIteration(frame.integralImg, frame.integralImgSquared);
+        else
+            varianceFilter->nextIteration(img); //Calculates integral images
+        std::vector<Mat> levels;
+        buildLevels(frame, levels);
+        ensembleClassifier->nextIteration(levels);
 
 #pragma omp parallel for
         for (int i = 0; i < numWindows; ++i)
@@ -288,7 +339,9 @@ namespace tld
                 continue;
             }
 
-            if (!nnClassifier->filter(img, i))
+            const int level = windowOffsets[TLD_WINDOW_OFFSET_SIZE * i + 7];
+
+            if (!nnClassifier->filter(levels[level], i, level))
             {
                 continue;
             }
@@ -302,4 +355,31 @@ namespace tld
 
         detectionResult->containsValidData = true;
     }
+
+    int DetectorCascade::usedPyramidLevels() const
+    {
+        return initialised ? numLevels : 1;
+    }
+
+    //Uses the pyramid of the frame if it has enough levels and computes the missing levels otherwise
+    void DetectorCascade::buildLevels(const PreprocessedFrame &frame, std::vector<Mat> &levels) const
+    {
+        levels.assign(1, frame.gray);
+
+        for (int level = 1; level < numLevels; level++)
+        {
+            Size size(imgWidth >> level, imgHeight >> level);
+
+            if (level < frame.numPyramidLevels() && frame.pyramid[level].size() == size)
+            {
+                levels.push_back(frame.pyramid[level]);
+            }
+            else
+            {
+                Mat next;
+                resize(levels.back(), next, size, 0, 0, INTER_AREA);
+                levels.push_back(next);
+            }
+        }
+    }
 } /* namespace tld */
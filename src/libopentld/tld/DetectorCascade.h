@@ -31,18 +31,24 @@
 #include "EnsembleClassifier.h"
 #include "Clustering.h"
 #include "NNClassifier.h"
+#include "PreprocessedFrame.h"
 
 namespace tld
 {
     //Constants
     static const int TLD_WINDOW_SIZE = 5;
-    static const int TLD_WINDOW_OFFSET_SIZE = 6;
+    static const int TLD_WINDOW_OFFSET_SIZE = 8;
 
     class DetectorCascade
     {
         //Working data
         int numScales;
         cv::Size *scales;
+        int *scaleLevels; //pyramid level on which each scale is evaluated
+        int numLevels; //number of pyramid levels used by the scales
+        std::vector<int> levelWidthSteps;
+
+        void buildLevels(const PreprocessedFrame &frame, std::vector<cv::Mat> &levels) const;
     public:
         //Configurable members
         int minScale;
@@ -52,6 +58,8 @@ namespace tld
         int minSize;
         int numFeatures;
         int numTrees;
+        int pyramidLevels; //1 evaluates all windows at full resolution
+        int pyramidMinSize; //windows are evaluated on the coarsest level on which they are at least this large
 
         //Needed for init
         int imgWidth;
@@ -88,6 +96,9 @@ namespace tld
         void release();
         void cleanPreviousData();
         void detect(const cv::Mat &img);
+        void detect(const PreprocessedFrame &frame);
+        //Number of pyramid levels detect() needs for the current window grid
+        int usedPyramidLevels() const;
     };
 } /* namespace tld */
 #endif /* DETECTORCASCADE_H_ */
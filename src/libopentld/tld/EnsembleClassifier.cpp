@@ -41,6 +41,7 @@ namespace tld
 #define sub2idx(x,y,widthstep) ((int) (floor((x)+0.5) + floor((y)+0.5)*(widthstep)))
 
     EnsembleClassifier::EnsembleClassifier() :
+        scaleLevels(NULL),
         features(NULL),
         featureOffsets(NULL),
         posteriors(NULL),
@@ -117,6 +118,7 @@ namespace tld
     //Creates offsets that can be added to bounding boxes
     //offsets are contained in the form delta11, delta12,... (combined index of dw and dh)
     //Order: scale.tree->feature
+    //Scales on a pyramid level use the scale size and the row step of that level
     void EnsembleClassifier::initFeatureOffsets()
     {
         featureOffsets = new int[numScales * numTrees * numFeatures * 2]{};
@@ -125,14 +127,27 @@ namespace tld
         for (int k = 0; k < numScales; k++)
         {
             Size scale = scales[k];
+            int level = (scaleLevels != NULL) ? scaleLevels[k] : 0;
 
             for (int i = 0; i < numTrees; i++)
             {
                 for (int j = 0; j < numFeatures; j++)
                 {
                     float *currentFeature = features + (4 * numFeatures) * i + 4 * j;
-                    *off++ = sub2idx((scale.width - 1) * currentFeature[0] + 1, (scale.height - 1) * currentFeature[1] + 1, imgWidthStep); //We add +1 because the index of the bounding box points to x-1, y-1
-                    *off++ = sub2idx((scale.width - 1) * currentFeature[2] + 1, (scale.height - 1) * currentFeature[3] + 1, imgWidthStep);
+
+                    if (level == 0)
+                    {
+                        *off++ = sub2idx((scale.width - 1) * currentFeature[0] + 1, (scale.height - 1) * currentFeature[1] + 1, imgWidthStep); //We add +1 because the index of the bounding box points to x-1, y-1
+                        *off++ = sub2idx((scale.width - 1) * currentFeature[2] + 1, (scale.height - 1) * currentFeature[3] + 1, imgWidthStep);
+                    }
+                    else
+                    {
+                        //On the levels the index of the bounding box points to x, y
+                        int levelWidth = scale.width >> level;
+                        int levelHeight = scale.height >> level;
+                        *off++ = sub2idx((levelWidth - 1) * currentFeature[0], (levelHeight - 1) * currentFeature[1], levelWidthSteps[level]);
+                        *off++ = sub2idx((levelWidth - 1) * currentFeature[2], (levelHeight - 1) * currentFeature[3], levelWidthSteps[level]);
+                    }
                 }
             }
         }
@@ -149,7 +164,17 @@ namespace tld
     {
         if (!enabled) return;
 
-        this->img = (const unsigned char *)img.data;
+        levelImgs.assign(1, (const unsigned char *)img.data);
+    }
+
+    void EnsembleClassifier::nextIteration(const std::vector<Mat> &levels)
+    {
+        if (!enabled) return;
+
+        levelImgs.resize(levels.size());
+
+        for (size_t i = 0; i < levels.size(); i++)
+            levelImgs[i] = (const unsigned char *)levels[i].data;
     }
 
     //Classical fern algorithm
@@ -158,13 +183,14 @@ namespace tld
         int index = 0;
         int *bbox = windowOffsets + windowIdx * TLD_WINDOW_OFFSET_SIZE;
         int *off = featureOffsets + bbox[4] + treeIdx * 2 * numFeatures; //bbox[4] is pointer to features for the current scale
+        const unsigned char *img = levelImgs[bbox[7]] + bbox[6]; //bbox[6] is the window position on its pyramid level bbox[7]
 
         for (int i = 0; i < numFeatures; i++)
         {
             index <<= 1;
 
-            int fp0 = img[bbox[0] + off[0]];
-            int fp1 = img[bbox[0] + off[1]];
+            int fp0 = img[off[0]];
+            int fp1 = img[off[1]];
 
             if (fp0 > fp1)
             {
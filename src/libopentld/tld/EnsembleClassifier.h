@@ -30,12 +30,13 @@
 #include<opencv2/highgui/highgui.hpp>
 #include <memory>
 #include <random>
+#include <vector>
 
 namespace tld
 {
     class EnsembleClassifier
     {
-        const unsigned char *img;
+        std::vector<const unsigned char *> levelImgs;
 
         float calcConfidence(int *featureVector);
         int calcFernFeature(int windowIdx, int treeIdx);
@@ -51,6 +52,8 @@ namespace tld
         int imgWidthStep;
         int numScales;
         cv::Size *scales;
+        int *scaleLevels;
+        std::vector<int> levelWidthSteps;
 
         int *windowOffsets;
         int *featureOffsets;
@@ -72,6 +75,7 @@ namespace tld
         void initPosteriors();
         void release();
         void nextIteration(const cv::Mat &img);
+        void nextIteration(const std::vector<cv::Mat> &levels);
         void classifyWindow(int windowIdx);
         void updatePosterior(int treeIdx, int idx, int positive, int amount);
         void learn(int *boundary, int positive, int *featureVector);
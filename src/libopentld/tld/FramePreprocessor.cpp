@@ -0,0 +1,285 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+ * FramePreprocessor.cpp
+ */
+
+#include "FramePreprocessor.h"
+
+#include<opencv2/imgproc/imgproc.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace cv;
+
+namespace tld
+{
+    namespace
+    {
+        //Fixed point coefficients of cv::COLOR_BGR2GRAY for 8 bit images
+        const int GRAY_SHIFT = 14;
+        const int GRAY_B = 1868;
+        const int GRAY_G = 9617;
+        const int GRAY_R = 4899;
+
+        //Adds the row above to the row prefix sums in ii and ii2
+        void addRowAbove(const int *iiAbove, const long long *ii2Above, int *ii, long long *ii2, int cols)
+        {
+            int i = 0;
+#if defined(__SSE2__)
+
+            for (; i + 4 <= cols; i += 4)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *)(iiAbove + i));
+                __m128i b = _mm_loadu_si128((const __m128i *)(ii + i));
+                _mm_storeu_si128((__m128i *)(ii + i), _mm_add_epi32(a, b));
+
+                __m128i a2 = _mm_loadu_si128((const __m128i *)(ii2Above + i));
+                __m128i b2 = _mm_loadu_si128((const __m128i *)(ii2 + i));
+                _mm_storeu_si128((__m128i *)(ii2 + i), _mm_add_epi64(a2, b2));
+                a2 = _mm_loadu_si128((const __m128i *)(ii2Above + i + 2));
+                b2 = _mm_loadu_si128((const __m128i *)(ii2 + i + 2));
+                _mm_storeu_si128((__m128i *)(ii2 + i + 2), _mm_add_epi64(a2, b2));
+            }
+
+#endif
+
+            for (; i < cols; i++)
+            {
+                ii[i] += iiAbove[i];
+                ii2[i] += ii2Above[i];
+            }
+        }
+
+#if defined(__SSE2__)
+        //Converts the 4 bgr pixels in the first 12 of the 16 bytes at src,
+        //one gray value per 32 bit lane
+        inline __m128i bgrToGray4(const unsigned char *src)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i coeffs = _mm_setr_epi16(GRAY_B, GRAY_G, GRAY_R, 0, GRAY_B, GRAY_G, GRAY_R, 0);
+            const __m128i rounding = _mm_set1_epi32(1 << (GRAY_SHIFT - 1));
+
+            //Pixel k starts at byte 3 * k; move every pixel to its own 32 bit lane,
+            //the fourth byte of a lane gets the coefficient 0
+            __m128i v = _mm_loadu_si128((const __m128i *)src);
+            __m128i p01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+            __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+            __m128i p = _mm_unpacklo_epi64(p01, p23);
+
+            //b * GRAY_B + g * GRAY_G and r * GRAY_R in neighbouring lanes
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(p, zero), coeffs);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(p, zero), coeffs);
+            lo = _mm_shuffle_epi32(_mm_add_epi32(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+            hi = _mm_shuffle_epi32(_mm_add_epi32(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+
+            return _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi64(lo, hi), rounding), GRAY_SHIFT);
+        }
+
+        //Inclusive prefix sums of the 4 lanes
+        inline __m128i prefixSum4(__m128i v)
+        {
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+            return _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        }
+#endif
+
+        /*
+         * Converts a bgr row to gray and writes its rows of the integral and
+         * the squared integral image; iiAbove and ii2Above are the rows above
+         * or NULL for the first row. With SSE2, 4 pixels are converted and
+         * summed per step; the running sums are carried in broadcast lanes.
+         */
+        void bgrToGrayIntegralRow(const unsigned char *src, unsigned char *dst,
+                                  const int *iiAbove, const long long *ii2Above, int *ii, long long *ii2, int cols)
+        {
+            int i = 0;
+            int rowSum = 0;
+            long long rowSumSquared = 0;
+#if defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128();
+            __m128i sum = zero;
+            __m128i sumSquared = zero;
+
+            //bgrToGray4 reads up to pixel i + 5
+            for (; i + 6 <= cols; i += 4)
+            {
+                __m128i value = bgrToGray4(src + 3 * i);
+                __m128i value16 = _mm_packs_epi32(value, value);
+                *(int *)(dst + i) = _mm_cvtsi128_si32(_mm_packus_epi16(value16, value16));
+
+                //The upper 16 bits of every lane are 0, so madd squares the value
+                __m128i squared = prefixSum4(_mm_madd_epi16(value, value));
+                sum = _mm_add_epi32(prefixSum4(value), sum);
+                __m128i squaredLo = _mm_add_epi64(_mm_unpacklo_epi32(squared, zero), sumSquared);
+                __m128i squaredHi = _mm_add_epi64(_mm_unpackhi_epi32(squared, zero), sumSquared);
+                __m128i out = sum;
+
+                if (iiAbove)
+                {
+                    out = _mm_add_epi32(out, _mm_loadu_si128((const __m128i *)(iiAbove + i)));
+                    _mm_storeu_si128((__m128i *)(ii2 + i), _mm_add_epi64(squaredLo, _mm_loadu_si128((const __m128i *)(ii2Above + i))));
+                    _mm_storeu_si128((__m128i *)(ii2 + i + 2), _mm_add_epi64(squaredHi, _mm_loadu_si128((const __m128i *)(ii2Above + i + 2))));
+                }
+                else
+                {
+                    _mm_storeu_si128((__m128i *)(ii2 + i), squaredLo);
+                    _mm_storeu_si128((__m128i *)(ii2 + i + 2), squaredHi);
+                }
+
+                _mm_storeu_si128((__m128i *)(ii + i), out);
+                sum = _mm_shuffle_epi32(sum, _MM_SHUFFLE(3, 3, 3, 3));
+                sumSquared = _mm_unpackhi_epi64(squaredHi, squaredHi);
+            }
+
+            rowSum = _mm_cvtsi128_si32(sum);
+            _mm_storel_epi64((__m128i *)&rowSumSquared, sumSquared);
+#endif
+
+            for (; i < cols; i++)
+            {
+                const unsigned char *pixel = src + 3 * i;
+                int value = (pixel[0] * GRAY_B + pixel[1] * GRAY_G + pixel[2] * GRAY_R + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+                dst[i] = (unsigned char)value;
+                rowSum += value;
+                rowSumSquared += value * value;
+                ii[i] = rowSum + (iiAbove ? iiAbove[i] : 0);
+                ii2[i] = rowSumSquared + (ii2Above ? ii2Above[i] : 0);
+            }
+        }
+
+        /*
+         * Converts bgr to gray and calculates the integral and the squared
+         * integral image in a single pass over the image.
+         */
+        void bgrToGrayIntegral(const Mat &bgr, Mat &gray, int *ii, long long *ii2)
+        {
+            const int cols = bgr.cols;
+            gray.create(bgr.size(), CV_8UC1);
+
+            for (int j = 0; j < bgr.rows; j++)
+            {
+                int *iiRow = ii + cols * j;
+                long long *ii2Row = ii2 + cols * j;
+
+                bgrToGrayIntegralRow(bgr.ptr<unsigned char>(j), gray.ptr<unsigned char>(j),
+                                     j > 0 ? iiRow - cols : NULL, j > 0 ? ii2Row - cols : NULL, iiRow, ii2Row, cols);
+            }
+        }
+
+        void grayIntegral(const Mat &gray, int *ii, long long *ii2)
+        {
+            const int cols = gray.cols;
+
+            for (int j = 0; j < gray.rows; j++)
+            {
+                const unsigned char *src = gray.ptr<unsigned char>(j);
+                int *iiRow = ii + cols * j;
+                long long *ii2Row = ii2 + cols * j;
+                int rowSum = 0;
+                long long rowSumSquared = 0;
+
+                for (int i = 0; i < cols; i++)
+                {
+                    int value = src[i];
+                    rowSum += value;
+                    rowSumSquared += value * value;
+                    iiRow[i] = rowSum;
+                    ii2Row[i] = rowSumSquared;
+                }
+
+                if (j > 0)
+                    addRowAbove(iiRow - cols, ii2Row - cols, iiRow, ii2Row, cols);
+            }
+        }
+    }
+
+    FramePreprocessor::FramePreprocessor() :
+        integralImages(true),
+        pyramidLevels(1)
+    {
+    }
+
+    void FramePreprocessor::process(const Mat &img, PreprocessedFrame &frame) const
+    {
+        CV_Assert(img.depth() == CV_8U);
+
+        frame.gray = Mat();
+        frame.integralImg.reset();
+        frame.integralImgSquared.reset();
+        frame.pyramid.clear();
+
+        if (integralImages)
+        {
+            IntegralImage<int> *ii = new IntegralImage<int>(img.size());
+            IntegralImage<long long> *ii2 = new IntegralImage<long long>(img.size());
+
+            if (img.channels() == 3)
+            {
+                bgrToGrayIntegral(img, frame.gray, ii->data, ii2->data);
+            }
+            else
+            {
+                if (img.channels() == 1)
+                    frame.gray = img;
+                else
+                    cvtColor(img, frame.gray, cv::COLOR_BGRA2GRAY);
+
+                grayIntegral(frame.gray, ii->data, ii2->data);
+            }
+
+            frame.integralImg.reset(ii);
+            frame.integralImgSquared.reset(ii2);
+        }
+        else if (img.channels() == 1)
+        {
+            frame.gray = img;
+        }
+        else
+        {
+            cvtColor(img, frame.gray, img.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+        }
+
+        buildPyramid(frame);
+    }
+
+    void FramePreprocessor::buildPyramid(PreprocessedFrame &frame) const
+    {
+        if (pyramidLevels <= 1)
+            return;
+
+        frame.pyramid.push_back(frame.gray);
+
+        for (int level = 1; level < pyramidLevels; level++)
+        {
+            const Mat &prev = frame.pyramid.back();
+
+            if (prev.cols < 2 || prev.rows < 2)
+                break;
+
+            //Exact factor 2, so that coordinates map to the next level by halving
+            Mat next;
+            resize(prev, next, Size(prev.cols / 2, prev.rows / 2), 0, 0, INTER_AREA);
+            frame.pyramid.push_back(next);
+        }
+    }
+} /* namespace tld */
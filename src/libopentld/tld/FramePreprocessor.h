@@ -0,0 +1,52 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+ * FramePreprocessor.h
+ *
+ * Computes the grayscale image, its integral images and an optional image
+ * pyramid once per frame. The result is handed to all consumers by const
+ * reference instead of every consumer converting the colour image itself.
+ */
+
+#ifndef FRAMEPREPROCESSOR_H_
+#define FRAMEPREPROCESSOR_H_
+
+#include<opencv2/core/core.hpp>
+
+#include "PreprocessedFrame.h"
+
+namespace tld
+{
+    class FramePreprocessor
+    {
+    public:
+        bool integralImages;
+        int pyramidLevels; // number of levels including the full resolution one, 1 disables the pyramid
+
+        FramePreprocessor();
+
+        /* img is a BGR or a grayscale image */
+        void process(const cv::Mat &img, PreprocessedFrame &frame) const;
+
+    private:
+        void buildPyramid(PreprocessedFrame &frame) const;
+    };
+} /* namespace tld */
+#endif /* FRAMEPREPROCESSOR_H_ */
@@ -43,6 +43,8 @@ namespace tld
 
         IntegralImage(cv::Size size)
         {
+            width = size.width;
+            height = size.height;
             data = new T[size.width * size.height];
         }
 
@@ -53,24 +55,25 @@ namespace tld
 
         void calcIntImg(const cv::Mat &img, bool squared = false)
         {
-            const unsigned char *input = (const unsigned char *)(img.data);
-            T *output = data;
-
-            for (int i = 0; i < img.cols; i++)
+            //Row by row, so that input and output are read sequentially
+            for (int j = 0; j < img.rows; j++)
             {
-                for (int j = 0; j < img.rows; j++)
+                const unsigned char *input = img.ptr<unsigned char>(j);
+                T *output = data + img.cols * j;
+                const T *above = output - img.cols;
+                T rowSum = 0;
+
+                for (int i = 0; i < img.cols; i++)
                 {
-                    T A = (i > 0) ? output[img.cols * j + i - 1] : 0;
-                    T B = (j > 0) ? output[img.cols * (j - 1) + i] : 0;
-                    T C = (j > 0 && i > 0) ? output[img.cols * (j - 1) + i - 1] : 0;
-                    T value = input[img.step * j + i];
+                    T value = input[i];
 
                     if (squared)
                     {
                         value = value * value;
                     }
 
-                    output[img.cols * j + i] = A + B - C + value;
+                    rowSum += value;
+                    output[i] = (j > 0) ? above[i] + rowSum : rowSum;
                 }
             }
         }
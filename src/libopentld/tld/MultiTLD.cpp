@@ -0,0 +1,175 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+ * MultiTLD.cpp
+ */
+
+#include "MultiTLD.h"
+
+#include <algorithm>
+
+#include "TLDUtil.h"
+
+using namespace cv;
+using namespace std;
+
+namespace tld
+{
+    MultiTLD::MultiTLD(const TargetFactory &factory) :
+        factory(factory),
+        nextId(0)
+    {
+    }
+
+    MultiTLD::~MultiTLD()
+    {
+        clear();
+    }
+
+    int MultiTLD::addTarget(const Mat &img, const Rect &bb)
+    {
+        if (img.empty() || bb.width <= 0 || bb.height <= 0)
+            return -1;
+
+        shared_ptr<TLD> target(factory());
+
+        if (!target)
+            return -1;
+
+        Rect targetBB = bb & Rect(0, 0, img.cols, img.rows);
+
+        if (targetBB.area() == 0)
+            return -1;
+
+        PreprocessedFrame frame;
+        preprocessor.integralImages = target->needsIntegralImages();
+        preprocessor.process(img, frame);
+        target->selectObject(img, &targetBB, frame);
+
+        int id = nextId++;
+        targets[id] = target;
+        return id;
+    }
+
+    bool MultiTLD::removeTarget(int id)
+    {
+        return targets.erase(id) > 0;
+    }
+
+    void MultiTLD::clear()
+    {
+        targets.clear();
+    }
+
+    size_t MultiTLD::numberOfTargets() const
+    {
+        return targets.size();
+    }
+
+    vector<int> MultiTLD::targetIds() const
+    {
+        vector<int> ids;
+        ids.reserve(targets.size());
+
+        for (map<int, shared_ptr<TLD> >::const_iterator it = targets.begin(); it != targets.end(); ++it)
+            ids.push_back(it->first);
+
+        return ids;
+    }
+
+    TLD *MultiTLD::target(int id) const
+    {
+        map<int, shared_ptr<TLD> >::const_iterator it = targets.find(id);
+
+        if (it == targets.end())
+            return NULL;
+
+        return it->second.get();
+    }
+
+    int MultiTLD::findTarget(const Rect &bb) const
+    {
+        int bestId = -1;
+        float bestOverlap = 0;
+
+        for (map<int, shared_ptr<TLD> >::const_iterator it = targets.begin(); it != targets.end(); ++it)
+        {
+            if (it->second->currBB == NULL)
+                continue;
+
+            float overlap = tldOverlapRectRect(*it->second->currBB, bb);
+
+            if (overlap > bestOverlap)
+            {
+                bestOverlap = overlap;
+                bestId = it->first;
+            }
+        }
+
+        return bestId;
+    }
+
+    void MultiTLD::setFrameGap(int frameGap)
+    {
+        for (map<int, shared_ptr<TLD> >::iterator it = targets.begin(); it != targets.end(); ++it)
+            it->second->frameGap = frameGap;
+    }
+
+    void MultiTLD::processImage(Mat &img, TLD *primary)
+    {
+        vector<TLD *> active;
+        active.reserve(targets.size() + 1);
+
+        if (primary != NULL)
+            active.push_back(primary);
+
+        for (map<int, shared_ptr<TLD> >::iterator it = targets.begin(); it != targets.end(); ++it)
+            active.push_back(it->second.get());
+
+        bool withIntegralImages = false;
+        int pyramidLevels = 1;
+
+        for (size_t i = 0; i < active.size(); ++i)
+        {
+            withIntegralImages = withIntegralImages || active[i]->needsIntegralImages();
+
+            if (active[i]->detectorEnabled)
+                pyramidLevels = max(pyramidLevels, active[i]->detectorCascade->usedPyramidLevels());
+        }
+
+        preprocessor.integralImages = withIntegralImages;
+        preprocessor.pyramidLevels = pyramidLevels;
+        preprocessor.process(img, currFrame);
+
+        // the cascades of the targets only read the shared frame data. A single
+        // target is run directly so that its detector can parallelise over windows.
+        const int numActive = static_cast<int>(active.size());
+#pragma omp parallel for schedule(dynamic) if (numActive > 1)
+        for (int i = 0; i < numActive; ++i)
+        {
+            active[i]->processImage(img, currFrame);
+        }
+    }
+
+    const PreprocessedFrame &MultiTLD::frame() const
+    {
+        return currFrame;
+    }
+} /* namespace tld */
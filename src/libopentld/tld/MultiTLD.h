@@ -0,0 +1,82 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+ * MultiTLD.h
+ *
+ * Tracks several targets in the same image stream. The grayscale image, the
+ * integral images and the detector pyramid are computed once per frame and
+ * shared by all targets, while every target keeps its own tracker, window
+ * grid, fern codes, posteriors and NN model. The targets are processed in
+ * parallel with OpenMP (WITH_OPENMP, on by default); without it they are
+ * processed one after another.
+ */
+
+#ifndef MULTITLD_H_
+#define MULTITLD_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include<opencv2/core/core.hpp>
+
+#include "TLD.h"
+#include "FramePreprocessor.h"
+
+namespace tld
+{
+    class MultiTLD
+    {
+    public:
+        /* Creates a configured TLD instance whose tracker has already been initialised */
+        typedef std::function<TLD *()> TargetFactory;
+
+        explicit MultiTLD(const TargetFactory &factory);
+        virtual ~MultiTLD();
+
+        /* Returns the id of the new target or -1 if it could not be created */
+        int addTarget(const cv::Mat &img, const cv::Rect &bb);
+        bool removeTarget(int id);
+        void clear();
+
+        size_t numberOfTargets() const;
+        std::vector<int> targetIds() const;
+        TLD *target(int id) const;
+        /* Returns the id of the target whose current box overlaps bb most or -1 */
+        int findTarget(const cv::Rect &bb) const;
+        /* Sets TLD::frameGap of all targets for the next processImage */
+        void setFrameGap(int frameGap);
+
+        /* Processes img for all targets in one parallel pass. If primary is not
+         * NULL, it is processed in the same pass on the shared frame data. */
+        void processImage(cv::Mat &img, TLD *primary = NULL);
+
+        const PreprocessedFrame &frame() const;
+
+    private:
+        TargetFactory factory;
+        std::map<int, std::shared_ptr<TLD> > targets;
+        int nextId;
+        FramePreprocessor preprocessor;
+        PreprocessedFrame currFrame;
+    };
+} /* namespace tld */
+#endif /* MULTITLD_H_ */
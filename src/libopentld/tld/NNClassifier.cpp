@@ -130,12 +130,16 @@ namespace tld
         return classifyPatch(&patch);
     }
 
-    float NNClassifier::classifyWindow(const Mat &img, int windowIdx)
+    float NNClassifier::classifyWindow(const Mat &img, int windowIdx, int level)
     {
         NormalizedPatch patch;
 
         int *bbox = &windows[TLD_WINDOW_SIZE * windowIdx];
-        tldExtractNormalizedPatchBB(img, bbox, patch.values);
+
+        if (level == 0)
+            tldExtractNormalizedPatchBB(img, bbox, patch.values);
+        else
+            tldExtractNormalizedPatch(img, bbox[0] >> level, bbox[1] >> level, bbox[2] >> level, bbox[3] >> level, patch.values);
 
         return classifyPatch(&patch);
     }
@@ -152,11 +156,11 @@ namespace tld
         imshow("NN positive detection", temp);
     }
 
-    bool NNClassifier::filter(const Mat &img, int windowIdx)
+    bool NNClassifier::filter(const Mat &img, int windowIdx, int level)
     {
         if (!enabled) return true;
 
-        float conf = classifyWindow(img, windowIdx);
+        float conf = classifyWindow(img, windowIdx, level);
 
         if (conf < thetaTP)
         {
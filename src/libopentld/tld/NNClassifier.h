@@ -56,9 +56,10 @@ namespace tld
         void release();
         float classifyPatch(NormalizedPatch *patch);
         float classifyBB(const cv::Mat &img, cv::Rect *bb);
-        float classifyWindow(const cv::Mat &img, int windowIdx);
+        float classifyWindow(const cv::Mat &img, int windowIdx, int level = 0);
         void learn(std::vector<NormalizedPatch> patches);
-        bool filter(const cv::Mat &img, int windowIdx);
+        //img is the pyramid level on which the window is evaluated
+        bool filter(const cv::Mat &img, int windowIdx, int level = 0);
     };
 } /* namespace tld */
 #endif /* NNCLASSIFIER_H_ */
@@ -0,0 +1,54 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+ * PreprocessedFrame.h
+ *
+ * Per-frame data which only depends on the input image and can
+ * therefore be shared by all targets that are tracked in that frame.
+ * It is filled by a FramePreprocessor.
+ */
+
+#ifndef PREPROCESSEDFRAME_H_
+#define PREPROCESSEDFRAME_H_
+
+#include <memory>
+#include <vector>
+
+#include<opencv2/core/core.hpp>
+
+#include "IntegralImage.h"
+
+namespace tld
+{
+    class PreprocessedFrame
+    {
+    public:
+        cv::Mat gray;
+        /* Integral images of gray. Empty if they have not been requested. */
+        std::shared_ptr<const IntegralImage<int> > integralImg;
+        std::shared_ptr<const IntegralImage<long long> > integralImgSquared;
+        /* pyramid[0] is gray, every further level is downsampled by 2. Empty if no pyramid has been requested. */
+        std::vector<cv::Mat> pyramid;
+
+        bool hasIntegralImages() const;
+        int numPyramidLevels() const;
+    };
+} /* namespace tld */
+#endif /* PREPROCESSEDFRAME_H_ */
@@ -53,29 +53,58 @@ namespace tld
         detectorEnabled = true;
         learningEnabled = true;
         alternating = false;
+        useDsstTracker = false;
+        frameGap = 0;
+        maxFrameGap = 5;
+        asyncDetection = false;
+        maxDetectionAge = 3;
+        detectionAge = -1;
+        frameNr = 0;
+        gapFrameNr = -1;
+        hasCompletedDetection = false;
+        detectorBusy = false;
+        detectorStopped = false;
         valid = false;
         learning = false;
         currBB = NULL;
         seed = 0;
+        kcfFeatures = FHOG_FEATURES;
+        dsstFeatures = FHOG_FEATURES;
         detectorCascade = new DetectorCascade();
         nnClassifier = detectorCascade->nnClassifier;
     }
 
     void TLD::init(bool useDsstTracker)
     {
+        this->useDsstTracker = useDsstTracker;
+
         if (!tracker)
         {
             if (useDsstTracker)
             {
-                DsstParameters dsstParameters;
                 dsstParameters.enableTrackingLossDetection = true;
-                tracker.reset(new DsstTracker(dsstParameters));
+
+                if (dsstFeatures == GRAY_FEATURES)
+                    tracker.reset(new DsstTracker_<GrayFeatureExtractor>(dsstParameters));
+                else if (dsstFeatures == COMPACT_HOG_FEATURES)
+                    tracker.reset(new DsstTracker_<CompactHogFeatureExtractor>(dsstParameters));
+                else if (dsstFeatures == COLOR_NAMES_FEATURES)
+                    tracker.reset(new DsstTracker_<ColorNamesFeatureExtractor>(dsstParameters));
+                else
+                    tracker.reset(new DsstTracker(dsstParameters));
             }
             else
             {
-                KcfParameters kcfParameters;
                 kcfParameters.enableTrackingLossDetection = true;
-                tracker.reset(new KcfTracker(kcfParameters));
+
+                if (kcfFeatures == GRAY_FEATURES)
+                    tracker.reset(new KcfTracker_<GrayFeatureExtractor>(kcfParameters));
+                else if (kcfFeatures == COMPACT_HOG_FEATURES)
+                    tracker.reset(new KcfTracker_<CompactHogFeatureExtractor>(kcfParameters));
+                else if (kcfFeatures == COLOR_NAMES_FEATURES)
+                    tracker.reset(new KcfTracker_<ColorNamesFeatureExtractor>(kcfParameters));
+                else
+                    tracker.reset(new KcfTracker(kcfParameters));
             }
         }
 
@@ -83,8 +112,43 @@ namespace tld
         // std::cout << "---------- " << tracker->getId() << " --------------" << "\n\n\n";
     }
 
+    void TLD::initFrom(const TLD &other)
+    {
+        trackerEnabled = other.trackerEnabled;
+        detectorEnabled = other.detectorEnabled;
+        learningEnabled = other.learningEnabled;
+        alternating = other.alternating;
+        maxFrameGap = other.maxFrameGap;
+        asyncDetection = other.asyncDetection;
+        maxDetectionAge = other.maxDetectionAge;
+        seed = other.seed;
+        kcfParameters = other.kcfParameters;
+        dsstParameters = other.dsstParameters;
+        kcfFeatures = other.kcfFeatures;
+        dsstFeatures = other.dsstFeatures;
+
+        const DetectorCascade *src = other.detectorCascade;
+        detectorCascade->varianceFilter->enabled = src->varianceFilter->enabled;
+        detectorCascade->ensembleClassifier->enabled = src->ensembleClassifier->enabled;
+        detectorCascade->nnClassifier->enabled = src->nnClassifier->enabled;
+        detectorCascade->useShift = src->useShift;
+        detectorCascade->shift = src->shift;
+        detectorCascade->minScale = src->minScale;
+        detectorCascade->maxScale = src->maxScale;
+        detectorCascade->minSize = src->minSize;
+        detectorCascade->numTrees = src->numTrees;
+        detectorCascade->numFeatures = src->numFeatures;
+        detectorCascade->pyramidLevels = src->pyramidLevels;
+        detectorCascade->pyramidMinSize = src->pyramidMinSize;
+        detectorCascade->nnClassifier->thetaTP = src->nnClassifier->thetaTP;
+        detectorCascade->nnClassifier->thetaFP = src->nnClassifier->thetaFP;
+
+        init(other.useDsstTracker);
+    }
+
     TLD::~TLD()
     {
+        stopDetector();
         storeCurrentData();
         deleteCurrentBB();
 
@@ -97,6 +161,7 @@ namespace tld
 
     void TLD::release()
     {
+        waitForDetector();
         detectorCascade->release();
         deleteCurrentBB();
     }
@@ -104,10 +169,30 @@ namespace tld
     void TLD::storeCurrentData()
     {
         isTrackerValid = false;
-        detectorCascade->cleanPreviousData(); //Reset detector results
+
+        // the detector thread owns the detection results
+        if (!detectorThread.joinable())
+            detectorCascade->cleanPreviousData(); //Reset detector results
+    }
+
+    bool TLD::needsIntegralImages() const
+    {
+        return detectorEnabled && detectorCascade->varianceFilter->enabled;
     }
 
     void TLD::selectObject(const Mat &img, Rect *bb)
+    {
+        if (!tracker)
+            return;
+
+        // initialLearning always runs the detector
+        PreprocessedFrame frame;
+        preprocessor.integralImages = needsIntegralImages();
+        preprocessor.process(img, frame);
+        selectObject(img, bb, frame);
+    }
+
+    void TLD::selectObject(const Mat &img, Rect *bb, const PreprocessedFrame &frame)
     {
         if (!tracker)
             return;
@@ -122,8 +207,11 @@ namespace tld
 
         rng->seed((unsigned long)seed);
 
-        Mat grayFrame;
-        cvtColor(img, grayFrame, cv::COLOR_BGR2GRAY);
+        // detections of the previous object must not reinitialise the tracker
+        waitForDetector();
+        gapFrameNr = -1;
+
+        const Mat &grayFrame = frame.gray;
 
         // initialize the image dimensions once
         if (!hasImageDimensions)
@@ -151,6 +239,7 @@ namespace tld
         tracker->reinit(img, *bb);
 
         currImg = grayFrame;
+        currFrame = frame;
         deleteCurrentBB();
         currBB = tldCopyRect(bb);
         currConf = 1;
@@ -160,15 +249,28 @@ namespace tld
     }
 
     void TLD::processImage(cv::Mat &img)
+    {
+        if (!tracker)
+            return;
+
+        // when alternating, the detector mostly does not run and computes the integral images and levels itself if it does
+        PreprocessedFrame frame;
+        preprocessor.integralImages = needsIntegralImages() && !alternating;
+        preprocessor.pyramidLevels = (detectorEnabled && !alternating) ? detectorCascade->usedPyramidLevels() : 1;
+        preprocessor.process(img, frame);
+        processImage(img, frame);
+    }
+
+    void TLD::processImage(cv::Mat &img, const PreprocessedFrame &frame)
     {
         if (!tracker)
             return;
 
         storeCurrentData();
 
-        Mat grayFrame;
-        cvtColor(img, grayFrame, cv::COLOR_BGR2GRAY);
-        currImg = grayFrame; // Store new image , right after storeCurrentData();
+        currImg = frame.gray; // Store new image , right after storeCurrentData();
+        currFrame = frame;
+        frameNr += 1 + frameGap;
 
         if (trackerEnabled && runTracker)
         {
@@ -178,18 +280,179 @@ namespace tld
                 runTracker = false;
         }
 
-        if (detectorEnabled && (!alternating || !isTrackerValid))
-            detectorCascade->detect(grayFrame);
+        // the tracker only searches around the last position, which assumes consecutive frames
+        bool afterGap = frameGap > maxFrameGap;
 
-        fuseHypotheses(img);
+        if (asyncDetection)
+        {
+            processImageAsync(img, afterGap);
+            return;
+        }
+
+        detectionAge = -1;
+
+        if (detectorEnabled && (!alternating || !isTrackerValid || afterGap))
+        {
+            detectorCascade->detect(currFrame);
+            detectionAge = 0;
+        }
+
+        if (afterGap && isTrackerValid && detectorEnabled && detectorCascade->detectionResult->numClusters == 1
+                && tldOverlapRectRect(trackerBB, *detectorCascade->detectionResult->detectorBB) < 0.5f)
+        {
+            // the target moved out of the search window while frames were skipped, the tracker
+            // is reinitialised at the detection
+            isTrackerValid = false;
+        }
+
+        fuseHypotheses(img, detectorCascade->detectionResult->numClusters, detectorCascade->detectionResult->detectorBB);
 
         learn();
     }
 
-    void TLD::fuseHypotheses(const Mat& colorImg)
+    int TLD::numberOfScales() const
+    {
+        if (!tracker)
+            return 0;
+
+        return tracker->getNumberOfScales();
+    }
+
+    void TLD::setNumberOfScales(int numberOfScales)
+    {
+        if (tracker)
+            tracker->setNumberOfScales(numberOfScales);
+    }
+
+    void TLD::processImageAsync(Mat &img, bool afterGap)
+    {
+        if (!detectorThread.joinable())
+        {
+            detectorStopped = false;
+            detectorThread = std::thread(&TLD::detectorLoop, this);
+        }
+
+        if (afterGap)
+            gapFrameNr = frameNr;
+
+        // the most recent detection that has not been used yet
+        CompletedDetection detection;
+        detection.numClusters = 0;
+        detectionAge = -1;
+
+        {
+            std::lock_guard<std::mutex> lock(detectorMutex);
+
+            if (hasCompletedDetection)
+            {
+                detection = completedDetection;
+                hasCompletedDetection = false;
+                detectionAge = frameNr - detection.frameNr;
+            }
+        }
+
+        // the target has moved since an older detection, reinitialising there would lose it
+        bool isRecent = detectionAge >= 0 && detectionAge <= maxDetectionAge;
+
+        if (!isRecent)
+            detection.numClusters = 0;
+
+        if (gapFrameNr >= 0 && isRecent && detection.frameNr >= gapFrameNr)
+        {
+            gapFrameNr = -1;
+
+            if (isTrackerValid && detection.numClusters == 1 && tldOverlapRectRect(trackerBB, detection.bb) < 0.5f)
+                isTrackerValid = false;
+        }
+
+        fuseHypotheses(img, detection.numClusters, &detection.bb);
+
+        learning = learningEnabled && valid && detectorEnabled;
+
+        if (!detectorEnabled || (alternating && isTrackerValid && gapFrameNr < 0))
+            return;
+
+        std::unique_ptr<DetectionJob> job(new DetectionJob());
+        job->frame = currFrame;
+        job->frameNr = frameNr;
+        job->learn = learning;
+
+        if (learning)
+            job->bb = *currBB;
+
+        // the caller may overwrite a grayscale input, the detector reads it later
+        if (job->frame.gray.data == img.data)
+            job->frame.gray = img.clone();
+
+        {
+            std::lock_guard<std::mutex> lock(detectorMutex);
+            // a queued frame that the detector has not started yet is replaced by the newer one
+            pendingDetection = std::move(job);
+        }
+
+        detectorCondition.notify_all();
+    }
+
+    void TLD::detectorLoop()
+    {
+        std::unique_lock<std::mutex> lock(detectorMutex);
+
+        while (true)
+        {
+            detectorCondition.wait(lock, [this]() { return detectorStopped || pendingDetection; });
+
+            if (detectorStopped)
+                return;
+
+            std::unique_ptr<DetectionJob> job = std::move(pendingDetection);
+            detectorBusy = true;
+            lock.unlock();
+
+            detectorCascade->detect(job->frame);
+
+            // learns from the windows of the frame the detector has just evaluated
+            if (job->learn)
+                learn(job->frame, job->bb);
+
+            DetectionResult *detectionResult = detectorCascade->detectionResult;
+
+            lock.lock();
+            completedDetection.frameNr = job->frameNr;
+            completedDetection.numClusters = detectionResult->numClusters;
+
+            if (detectionResult->numClusters == 1)
+                completedDetection.bb = *detectionResult->detectorBB;
+
+            hasCompletedDetection = true;
+            detectorBusy = false;
+            detectorCondition.notify_all();
+        }
+    }
+
+    void TLD::waitForDetector()
+    {
+        std::unique_lock<std::mutex> lock(detectorMutex);
+        pendingDetection.reset();
+        detectorCondition.wait(lock, [this]() { return !detectorBusy; });
+        hasCompletedDetection = false;
+    }
+
+    void TLD::stopDetector()
+    {
+        if (!detectorThread.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(detectorMutex);
+            detectorStopped = true;
+        }
+
+        detectorCondition.notify_all();
+        detectorThread.join();
+    }
+
+    void TLD::fuseHypotheses(const Mat& colorImg, int numClusters, Rect *detectorBB)
     {
-        int numClusters = detectorCascade->detectionResult->numClusters;
-        Rect *detectorBB = detectorCascade->detectionResult->detectorBB;
         deleteCurrentBB();
 
         currConf = 0;
@@ -207,6 +470,8 @@ namespace tld
 
         float confDetector = 0;
 
+        std::lock_guard<std::mutex> lock(modelMutex);
+
         if (numClusters == 1)
             confDetector = nnClassifier->classifyBB(currImg, detectorBB);
 
@@ -245,7 +510,7 @@ namespace tld
 
         DetectionResult *detectionResult = detectorCascade->detectionResult;
 
-        detectorCascade->detect(currImg);
+        detectorCascade->detect(currFrame);
 
         //This is the positive patch
         NormalizedPatch initPatch;
@@ -325,17 +590,24 @@ namespace tld
 
         learning = true;
 
+        learn(currFrame, *currBB);
+    }
+
+    void TLD::learn(const PreprocessedFrame &frame, const Rect &bb)
+    {
         DetectionResult *detectionResult = detectorCascade->detectionResult;
+        const Mat &img = frame.gray;
+        Rect box = bb;
 
         if (!detectionResult->containsValidData)
-            detectorCascade->detect(currImg);
+            detectorCascade->detect(frame);
 
         //This is the positive patch
         NormalizedPatch patch;
-        tldExtractNormalizedPatchRect(currImg, currBB, patch.values);
+        tldExtractNormalizedPatchRect(img, &box, patch.values);
 
         float *overlap = new float[detectorCascade->numWindows]{};
-        tldOverlapRect(detectorCascade->windows, detectorCascade->numWindows, currBB, overlap);
+        tldOverlapRect(detectorCascade->windows, detectorCascade->numWindows, &box, overlap);
 
         //Add all bounding boxes with high overlap
         vector<pair<int, float> > positiveIndices;
@@ -395,12 +667,15 @@ namespace tld
             int idx = negativeIndicesForNN.at(i);
 
             NormalizedPatch patch;
-            tldExtractNormalizedPatchBB(currImg, &detectorCascade->windows[TLD_WINDOW_SIZE * idx], patch.values);
+            tldExtractNormalizedPatchBB(img, &detectorCascade->windows[TLD_WINDOW_SIZE * idx], patch.values);
             patch.positive = 0;
             patches.push_back(patch);
         }
 
-        detectorCascade->nnClassifier->learn(patches);
+        {
+            std::lock_guard<std::mutex> lock(modelMutex);
+            detectorCascade->nnClassifier->learn(patches);
+        }
 
         //cout << "NN has now " << detectorCascade->nnClassifier->truePositives->size() << " positives and " << detectorCascade->nnClassifier->falsePositives->size() << " negatives.\n";
 
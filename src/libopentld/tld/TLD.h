@@ -29,27 +29,74 @@
 
 #include<opencv2/core/core.hpp>
 #include<opencv2/highgui/highgui.hpp>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <thread>
 #include "opencv2/core/core.hpp"
 #include "cf_tracker.hpp"
+#include "kcf_tracker.hpp"
+#include "dsst_tracker.hpp"
 #include "DetectorCascade.h"
+#include "FramePreprocessor.h"
 
 namespace tld
 {
     class TLD
     {
     private:
+        // a frame handed to the detector thread, learnt at bb after the detection if learn is set
+        struct DetectionJob
+        {
+            PreprocessedFrame frame;
+            int frameNr;
+            bool learn;
+            cv::Rect bb;
+        };
+
+        // the result of a DetectionJob
+        struct CompletedDetection
+        {
+            int frameNr;
+            int numClusters;
+            cv::Rect bb;
+        };
+
         void storeCurrentData();
-        void fuseHypotheses(const cv::Mat& colorImg);
+        void fuseHypotheses(const cv::Mat& colorImg, int numClusters, cv::Rect *detectorBB);
+        void processImageAsync(cv::Mat &img, bool afterGap);
+        void detectorLoop();
+        // drops the queued job and waits until the detector thread is idle
+        void waitForDetector();
+        void stopDetector();
         void learn();
+        void learn(const PreprocessedFrame &frame, const cv::Rect &bb);
         void initialLearning();
         void deleteCurrentBB();
         std::shared_ptr<cf_tracking::CfTracker> tracker;
+
+        // number of the current frame including the skipped ones
+        int frameNr;
+        // frame after a gap whose tracker box is still to be checked by a detection, -1 if none
+        int gapFrameNr;
+
+        std::thread detectorThread;
+        std::mutex detectorMutex;
+        std::condition_variable detectorCondition;
+        std::unique_ptr<DetectionJob> pendingDetection;
+        CompletedDetection completedDetection;
+        bool hasCompletedDetection;
+        bool detectorBusy;
+        bool detectorStopped;
+        // the detector thread learns while the caller classifies with the NN model
+        std::mutex modelMutex;
     public:
         DetectorCascade *detectorCascade;
         NNClassifier *nnClassifier;
         cv::Mat currImg;
+        PreprocessedFrame currFrame;
+        FramePreprocessor preprocessor;
         cv::Rect *currBB;
         cv::Rect trackerBB;
         bool valid;
@@ -63,15 +110,42 @@ namespace tld
         bool detectorEnabled;
         bool learningEnabled;
         bool alternating;
+        bool useDsstTracker;
+        // frames skipped before the next processed one, set by the caller
+        int frameGap;
+        // after more skipped frames the detector checks whether the target left the tracker's search window
+        int maxFrameGap;
+        // detects in frame t on a separate thread while the tracker processes frame t+1
+        bool asyncDetection;
+        // in asynchronous mode, the tracker is only reinitialised at detections of at most this many frames ago
+        int maxDetectionAge;
+        // frames between the detection used by the last processImage and its frame, -1 if none was used
+        int detectionAge;
         std::shared_ptr<std::mt19937> rng;
         int seed;
 
+        // used by init() to create the tracker
+        cf_tracking::KcfParameters kcfParameters;
+        cf_tracking::DsstParameters dsstParameters;
+        int kcfFeatures; // one of cf_tracking::FeatureType
+        int dsstFeatures;
+
         TLD();
         virtual ~TLD();
         void init(bool useDsstTracker);
+        // copies the configuration of other and creates the tracker
+        void initFrom(const TLD &other);
         void release();
+        // true if the detector uses the integral images of a PreprocessedFrame
+        bool needsIntegralImages() const;
         void selectObject(const cv::Mat &img, cv::Rect *bb);
+        void selectObject(const cv::Mat &img, cv::Rect *bb, const PreprocessedFrame &frame);
         void processImage(cv::Mat &img);
+        // frame has to be computed from img, e.g. once for all targets of a MultiTLD
+        void processImage(cv::Mat &img, const PreprocessedFrame &frame);
+        // number of scales searched by the scale filter of the tracker, 0 if it has none
+        int numberOfScales() const;
+        void setNumberOfScales(int numberOfScales);
     };
 } /* namespace tld */
 #endif /* TLD_H_ */
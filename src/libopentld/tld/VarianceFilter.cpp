@@ -37,8 +37,6 @@ namespace tld
     {
         enabled = true;
         minVar = 0;
-        integralImg = NULL;
-        integralImg_squared = NULL;
     }
 
     VarianceFilter::~VarianceFilter()
@@ -48,19 +46,14 @@ namespace tld
 
     void VarianceFilter::release()
     {
-        if (integralImg != NULL) delete integralImg;
-
-        integralImg = NULL;
-
-        if (integralImg_squared != NULL) delete integralImg_squared;
-
-        integralImg_squared = NULL;
+        integralImg.reset();
+        integralImg_squared.reset();
     }
 
     float VarianceFilter::calcVariance(int *off)
     {
-        int *ii1 = integralImg->data;
-        long long *ii2 = integralImg_squared->data;
+        const int *ii1 = integralImg->data;
+        const long long *ii2 = integralImg_squared->data;
 
         float mX = (ii1[off[3]] - ii1[off[2]] - ii1[off[1]] + ii1[off[0]]) / (float)off[5]; //Sum of Area divided by area
         float mX2 = (ii2[off[3]] - ii2[off[2]] - ii2[off[1]] + ii2[off[0]]) / (float)off[5];
@@ -71,13 +64,23 @@ namespace tld
     {
         if (!enabled) return;
 
-        release();
+        IntegralImage<int> *ii = new IntegralImage<int>(img.size());
+        ii->calcIntImg(img);
+
+        IntegralImage<long long> *ii2 = new IntegralImage<long long>(img.size());
+        ii2->calcIntImg(img, true);
 
-        integralImg = new IntegralImage<int>(img.size());
-        integralImg->calcIntImg(img);
+        integralImg.reset(ii);
+        integralImg_squared.reset(ii2);
+    }
+
+    void VarianceFilter::nextIteration(const std::shared_ptr<const IntegralImage<int> > &ii,
+                                       const std::shared_ptr<const IntegralImage<long long> > &ii2)
+    {
+        if (!enabled) return;
 
-        integralImg_squared = new IntegralImage<long long>(img.size());
-        integralImg_squared->calcIntImg(img, true);
+        integralImg = ii;
+        integralImg_squared = ii2;
     }
 
     bool VarianceFilter::filter(int i)
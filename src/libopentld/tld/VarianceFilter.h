@@ -26,6 +26,8 @@
 #ifndef VARIANCEFILTER_H_
 #define VARIANCEFILTER_H_
 
+#include <memory>
+
 #include<opencv2/core/core.hpp>
 #include<opencv2/highgui/highgui.hpp>
 
@@ -36,8 +38,8 @@ namespace tld
 {
     class VarianceFilter
     {
-        IntegralImage<int>* integralImg;
-        IntegralImage<long long>* integralImg_squared;
+        std::shared_ptr<const IntegralImage<int> > integralImg;
+        std::shared_ptr<const IntegralImage<long long> > integralImg_squared;
 
     public:
         bool enabled;
@@ -52,6 +54,9 @@ namespace tld
 
         void release();
         void nextIteration(const cv::Mat &img);
+        /* Uses integral images that have already been calculated for the current frame */
+        void nextIteration(const std::shared_ptr<const IntegralImage<int> > &ii,
+                           const std::shared_ptr<const IntegralImage<long long> > &ii2);
         bool filter(int idx);
         float calcVariance(int *off);
     };
@@ -0,0 +1,98 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+
+#include "Main.h"
+
+// ROS
+#include <ros/ros.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+// STD
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cf_tld_ros
+{
+
+/**
+ * Runs Main inside a nodelet manager, e.g. the one of the camera driver, so the images are
+ * passed as shared pointers instead of being serialized. Takes the same arguments as cftld.
+ */
+class CFtldNodelet : public nodelet::Nodelet
+{
+public:
+    CFtldNodelet() :
+        main(NULL)
+    {
+    }
+
+    ~CFtldNodelet()
+    {
+        if (main != NULL)
+        {
+            main->requestStop();
+
+            if (worker.joinable())
+                worker.join();
+
+            delete main;
+        }
+    }
+
+private:
+    virtual void onInit()
+    {
+        // getopt expects the program name first
+        std::vector<std::string> args(getMyArgv());
+        args.insert(args.begin(), getName());
+
+        std::vector<char *> argv;
+
+        for (size_t i = 0; i < args.size(); i++)
+        {
+            argv.push_back(&args[i][0]);
+        }
+
+        argv.push_back(NULL);
+
+        main = new Main();
+        main->isNodelet = true;
+
+        if (main->init(static_cast<int>(args.size()), argv.data(), getMTNodeHandle()) == PROGRAM_EXIT)
+        {
+            NODELET_ERROR("Invalid arguments, cftld nodelet not started");
+            delete main;
+            main = NULL;
+            return;
+        }
+
+        // doWork is the processing loop, onInit has to return
+        worker = std::thread(&Main::doWork, main);
+    }
+
+    Main *main;
+    std::thread worker;
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(cf_tld_ros::CFtldNodelet, nodelet::Nodelet)
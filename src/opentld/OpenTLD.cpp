@@ -22,17 +22,9 @@
 */
 
 #include "Main.h"
-#include "Config.h"
-#include "ImAcq.h"
-#include <random>
 
 // ROS
 #include <ros/ros.h>
-#include "ros/ros_grabber.hpp"
-#include "ros/ros_grabber_depth.hpp"
-
-using tld::Config;
-using tld::Settings;
 
 
 int main(int argc, char **argv)
@@ -40,30 +32,12 @@ int main(int argc, char **argv)
     ros::init(argc, argv, "cf_tld_ros", ros::init_options::AnonymousName);
 
     Main *main = new Main();
-    Config config;
-    ImAcq *imAcq = imAcqAlloc();
-    
-    main->imAcq = imAcq;
 
-    if (config.init(argc, argv) == PROGRAM_EXIT)
+    if (main->init(argc, argv, ros::NodeHandle()) == PROGRAM_EXIT)
     {
         return EXIT_FAILURE;
     }
 
-    config.configure(main);
-
-    if (main->isRosUsed) {
-        ROSGrabber *ros_grabber = new ROSGrabber(config.m_settings.color_topic);
-        ROSGrabberDepth *ros_grabber_depth = new ROSGrabberDepth(config.m_settings.depth_topic);
-        main->ros_grabber = ros_grabber;
-        main->ros_grabber_depth = ros_grabber_depth;
-        ROS_DEBUG(">>> Finished ROS init");
-    }
-
-    main->tld->seed = main->seed;
-    main->frame_modulo = config.m_settings.frame_modulo;
-    imAcqInit(imAcq);
-
     main->doWork();
 
     delete main;
@@ -0,0 +1,345 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+ * CFBenchmark.cpp
+ *
+ * Micro benchmarks of the correlation filter building blocks. Built with
+ * -DBUILD_BENCHMARKS=ON, it needs neither ROS nor a test framework.
+ *
+ *   cftld_benchmark fhog [iterations]
+ *       row major FHOG against the col major baseline and the transposed variant
+ *   cftld_benchmark scales [iterations]
+ *       latency of a KCF update with the VOT scale search on one thread and on all threads
+ *   cftld_benchmark kernels imgPath x y w h [groundTruth]
+ *       speed and accuracy of the KCF kernels on an image sequence, e.g.
+ *       sample/sample_sequence_compressed/%.5d.jpg 261 48 39 65
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "feature_channels.hpp"
+#include "gradientMex.hpp"
+#include "kcf_tracker.hpp"
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+    typedef cf_tracking::FeatureChannels_<31, float> FhogChannels;
+
+    // milliseconds per call of f after one warm up call
+    template<typename F>
+    double timeMs(F f, int iterations)
+    {
+        f();
+
+        double start = static_cast<double>(getTickCount());
+
+        for (int i = 0; i < iterations; ++i)
+            f();
+
+        return (static_cast<double>(getTickCount()) - start) * 1000.0 / getTickFrequency() / iterations;
+    }
+
+    void printRow(const char *name, double ms, double baselineMs)
+    {
+        printf("%-32s %10.4f ms %8.2fx\n", name, ms, baselineMs / ms);
+    }
+
+    void printUsage(const char *program)
+    {
+        printf("Usage: %s fhog [iterations]\n", program);
+        printf("       %s scales [iterations]\n", program);
+        printf("       %s kernels imgPath x y w h [groundTruth]\n", program);
+    }
+
+    // the patch size the request for the row major path was measured on
+    int benchmarkFhog(int iterations)
+    {
+        const int binSize = 4;
+        Mat patch(100, 100, CV_32FC3);
+        setRNGSeed(0);
+        randu(patch, Scalar::all(0), Scalar::all(255));
+
+        shared_ptr<FhogChannels> colMajor(new FhogChannels());
+        shared_ptr<FhogChannels> transposed(new FhogChannels());
+        shared_ptr<FhogChannels> rowMajor(new FhogChannels());
+
+        printf("FHOG of a %dx%d patch, bin size %d, %d iterations\n", patch.cols, patch.rows, binSize, iterations);
+
+        double colMs = timeMs([&]() { piotr::cvFhog<float, FhogChannels>(patch, colMajor, binSize); }, iterations);
+        double transposedMs = timeMs([&]() { piotr::cvFhogT<float, FhogChannels>(patch, transposed, binSize); }, iterations);
+        double rowMs = timeMs([&]() { piotr::cvFhogRowMajor<float, FhogChannels>(patch, rowMajor, binSize); }, iterations);
+
+        printRow("cvFhog (col major)", colMs, colMs);
+        printRow("cvFhogT (transposed)", transposedMs, colMs);
+        printRow("cvFhogRowMajor", rowMs, colMs);
+
+        // the scale estimator writes every sample into one column
+        const int numCells = (patch.cols / binSize) * (patch.rows / binSize);
+        Mat column(numCells * 31, 1, CV_32FC1);
+
+        double colColMs = timeMs([&]() { piotr::fhogToCol<float>(patch, column, binSize, 0, 1.0f); }, iterations);
+        double transposedColMs = timeMs([&]() { piotr::fhogToCvColT<float>(patch, column, binSize, 0, 1.0f); }, iterations);
+        double rowColMs = timeMs([&]() { piotr::fhogToColRowMajor<float>(patch, column, binSize, 0, 1.0f); }, iterations);
+
+        printRow("fhogToCol (col major)", colColMs, colColMs);
+        printRow("fhogToCvColT (transposed)", transposedColMs, colColMs);
+        printRow("fhogToColRowMajor", rowColMs, colColMs);
+
+        // both layouts hold the same cells up to float rounding
+        double maxDifference = 0;
+
+        for (int c = 0; c < FhogChannels::numberOfChannels(); ++c)
+            maxDifference = max(maxDifference, norm(colMajor->channels[c], rowMajor->channels[c], NORM_INF));
+
+        printf("max difference row major - col major: %g\n", maxDifference);
+        return EXIT_SUCCESS;
+    }
+
+    // milliseconds per update of a KCF tracker with the VOT scale search on a static frame
+    double timeVotUpdate(const Mat &frame, const Rect_<int> &box, int iterations)
+    {
+        cf_tracking::KcfParameters paras;
+        paras.useVotScaleEstimation = true;
+        paras.useDsstScaleEstimation = false;
+
+        cf_tracking::KcfTracker tracker(paras);
+        Rect_<int> initBox = box;
+        tracker.reinit(frame, initBox);
+
+        return timeMs([&]() {
+            Rect_<int> trackedBox = box;
+            tracker.update(frame, trackedBox);
+        }, iterations);
+    }
+
+    // the scale hypotheses of detectScales are evaluated in parallel with OpenMP
+    int benchmarkScales(int iterations)
+    {
+        Mat frame(480, 640, CV_8UC3);
+        setRNGSeed(0);
+        randu(frame, Scalar::all(0), Scalar::all(255));
+        Rect_<int> box(270, 190, 100, 100);
+
+        printf("KCF update with VOT scale search, %dx%d frame, %dx%d target, %d iterations\n",
+               frame.cols, frame.rows, box.width, box.height, iterations);
+
+#ifdef _OPENMP
+        int maxThreads = omp_get_max_threads();
+        omp_set_num_threads(1);
+        double serialMs = timeVotUpdate(frame, box, iterations);
+        omp_set_num_threads(maxThreads);
+        double parallelMs = timeVotUpdate(frame, box, iterations);
+
+        printRow("serial (1 thread)", serialMs, serialMs);
+        char name[64];
+        sprintf(name, "parallel (%d threads)", maxThreads);
+        printRow(name, parallelMs, serialMs);
+#else
+        double serialMs = timeVotUpdate(frame, box, iterations);
+        printRow("serial (built without OpenMP)", serialMs, serialMs);
+#endif
+        return EXIT_SUCCESS;
+    }
+
+    double overlap(const Rect_<double> &a, const Rect_<double> &b)
+    {
+        double intersection = (a & b).area();
+        double area = a.area() + b.area() - intersection;
+        return (area > 0) ? intersection / area : 0;
+    }
+
+    // frames are numbered from 1 like the IMGS acquisition method
+    vector<Mat> loadSequence(const char *imgPath)
+    {
+        vector<Mat> frames;
+        char path[1024];
+
+        for (int i = 1;; ++i)
+        {
+            snprintf(path, sizeof(path), imgPath, i);
+            Mat frame = imread(path);
+
+            if (frame.empty())
+                break;
+
+            frames.push_back(frame);
+        }
+
+        return frames;
+    }
+
+    // one box per line as x,y,w,h
+    vector<Rect_<double> > loadGroundTruth(const char *groundTruthPath)
+    {
+        vector<Rect_<double> > boxes;
+        ifstream file(groundTruthPath);
+        string line;
+
+        while (getline(file, line))
+        {
+            Rect_<double> box;
+
+            if (sscanf(line.c_str(), "%lf,%lf,%lf,%lf", &box.x, &box.y, &box.width, &box.height) == 4)
+                boxes.push_back(box);
+        }
+
+        return boxes;
+    }
+
+    struct KernelResult
+    {
+        double msPerFrame;
+        int trackedFrames;
+        vector<Rect_<double> > boxes; // empty where the target was lost
+    };
+
+    KernelResult trackSequence(const vector<Mat> &frames, const Rect_<int> &initBox, int kernelType)
+    {
+        cf_tracking::KcfParameters paras;
+        paras.kernelType = kernelType;
+        // as configured by TLD
+        paras.enableTrackingLossDetection = true;
+
+        cf_tracking::KcfTracker tracker(paras);
+        Rect_<double> box = initBox;
+        tracker.reinit(frames[0], box);
+
+        KernelResult result;
+        result.trackedFrames = 0;
+        result.boxes.push_back(box);
+        double ticks = 0;
+
+        for (size_t i = 1; i < frames.size(); ++i)
+        {
+            double start = static_cast<double>(getTickCount());
+            bool isTracked = tracker.update(frames[i], box);
+            ticks += static_cast<double>(getTickCount()) - start;
+
+            if (isTracked)
+                result.trackedFrames++;
+
+            result.boxes.push_back(isTracked ? box : Rect_<double>());
+        }
+
+        result.msPerFrame = ticks * 1000.0 / getTickFrequency() / max<size_t>(frames.size() - 1, 1);
+        return result;
+    }
+
+    // without ground truth the boxes of the gaussian kernel are the reference
+    int benchmarkKernels(const char *imgPath, const Rect_<int> &initBox, const char *groundTruthPath)
+    {
+        vector<Mat> frames = loadSequence(imgPath);
+
+        if (frames.size() < 2)
+        {
+            printf("Could not read an image sequence from %s\n", imgPath);
+            return EXIT_FAILURE;
+        }
+
+        const char *names[] = { "gaussian", "polynomial", "linear" };
+        const int kernels[] = { cf_tracking::KcfParameters::GAUSSIAN_KERNEL,
+                                cf_tracking::KcfParameters::POLYNOMIAL_KERNEL,
+                                cf_tracking::KcfParameters::LINEAR_KERNEL };
+        vector<KernelResult> results;
+
+        for (int k = 0; k < 3; ++k)
+            results.push_back(trackSequence(frames, initBox, kernels[k]));
+
+        vector<Rect_<double> > reference = results[0].boxes;
+
+        if (groundTruthPath != NULL)
+            reference = loadGroundTruth(groundTruthPath);
+
+        printf("%d frames, mean overlap with %s\n\n", static_cast<int>(frames.size()),
+               (groundTruthPath != NULL) ? "the ground truth" : "the gaussian kernel");
+        printf("| kernel | ms/frame | fps | tracked frames | mean overlap |\n");
+        printf("|---|---|---|---|---|\n");
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const KernelResult &result = results[k];
+            size_t numFrames = min(result.boxes.size(), reference.size());
+            double overlapSum = 0;
+
+            for (size_t i = 0; i < numFrames; ++i)
+                overlapSum += overlap(result.boxes[i], reference[i]);
+
+            printf("| %s | %.2f | %.1f | %d/%d | %.3f |\n", names[k], result.msPerFrame, 1000.0 / result.msPerFrame,
+                   result.trackedFrames, static_cast<int>(frames.size()) - 1, overlapSum / max<size_t>(numFrames, 1));
+        }
+
+        return EXIT_SUCCESS;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    string mode = argv[1];
+
+    if (mode == "kernels")
+    {
+        if (argc < 7)
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        Rect_<int> initBox(atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]));
+        return benchmarkKernels(argv[2], initBox, (argc > 7) ? argv[7] : NULL);
+    }
+
+    int iterations = (argc > 2) ? atoi(argv[2]) : 1000;
+
+    if (iterations < 1)
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (mode == "fhog")
+        return benchmarkFhog(iterations);
+
+    if (mode == "scales")
+        return benchmarkScales(iterations);
+
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -55,6 +55,31 @@ namespace tld
         "arguments:\n"
         "[<path>] <path> to the config file\n";
 
+    // reads the feature names of a tracker; returns false on unknown names
+    static bool lookupFeatures(libconfig::Config &cfg, const char *path, int &features)
+    {
+        string name;
+
+        if (!cfg.lookupValue(path, name))
+            return true;
+
+        if (name.compare("fhog") == 0)
+            features = cf_tracking::FHOG_FEATURES;
+        else if (name.compare("gray") == 0)
+            features = cf_tracking::GRAY_FEATURES;
+        else if (name.compare("hog") == 0)
+            features = cf_tracking::COMPACT_HOG_FEATURES;
+        else if (name.compare("colornames") == 0)
+            features = cf_tracking::COLOR_NAMES_FEATURES;
+        else
+        {
+            cerr << "Error: " << path << " has to be one of fhog, gray, hog, colornames." << endl;
+            return false;
+        }
+
+        return true;
+    }
+
     Config::Config() :
         m_methodSet(false),
         m_startFrameSet(false),
@@ -67,7 +92,8 @@ namespace tld
         m_imagePathSet(false),
         m_initialBBSet(false),
         m_showOutputSet(false),
-        m_useDsstTrackerSet(false)
+        m_useDsstTrackerSet(false),
+        m_targetRateSet(false)
     {
     }
 
@@ -85,6 +111,9 @@ namespace tld
         // check cli arguments
         int c;
 
+        // getopt keeps its state globally; reset it, several nodelets may parse their arguments in one process
+        optind = 1;
+
         while ((c = getopt(argc, argv, "a:b:C:d:D:e:f:fhi:j:m:n:Op:qst:z:x")) != -1)
         {
             switch (c)
@@ -174,7 +203,8 @@ namespace tld
                 m_settings.depth_topic = optarg;
                 break;
             case 'f':
-                m_settings.frame_modulo = atoi(optarg);
+                m_settings.m_targetRate = static_cast<float>(atof(optarg));
+                m_targetRateSet = true;
                 break;
             }
         }
@@ -297,6 +327,23 @@ namespace tld
             if (!m_camNoSet)
                 m_cfg.lookupValue("acq.camNo", m_settings.m_camNo);
 
+            // syncRgbd, maxSkew, syncQueueSize
+            m_cfg.lookupValue("acq.syncRgbd", m_settings.m_syncRgbd);
+            m_cfg.lookupValue("acq.maxSkew", m_settings.m_maxSkew);
+            m_cfg.lookupValue("acq.syncQueueSize", m_settings.m_syncQueueSize);
+
+            if (m_settings.m_maxSkew <= 0.0f)
+            {
+                cerr << "Error: acq.maxSkew has to be positive." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            if (m_settings.m_syncQueueSize < 1)
+            {
+                cerr << "Error: acq.syncQueueSize has to be at least 1." << endl;
+                return PROGRAM_EXIT;
+            }
+
             // useProportionalShift
             m_cfg.lookupValue("detector.useProportionalShift", m_settings.m_useProportionalShift);
 
@@ -322,6 +369,32 @@ namespace tld
             m_cfg.lookupValue("detector.thetaP", m_settings.m_thetaP);
             m_cfg.lookupValue("detector.thetaN", m_settings.m_thetaN);
 
+            // pyramidLevels, pyramidMinSize
+            m_cfg.lookupValue("detector.pyramidLevels", m_settings.m_detectorPyramidLevels);
+            m_cfg.lookupValue("detector.pyramidMinSize", m_settings.m_detectorPyramidMinSize);
+
+            if (m_settings.m_detectorPyramidLevels < 1 || m_settings.m_detectorPyramidLevels > 3)
+            {
+                cerr << "Error: detector.pyramidLevels has to be 1, 2 or 3." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            if (m_settings.m_detectorPyramidMinSize < 15)
+            {
+                cerr << "Error: detector.pyramidMinSize has to be at least the NN patch size of 15." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            // async, maxDetectionAge
+            m_cfg.lookupValue("detector.async", m_settings.m_asyncDetection);
+            m_cfg.lookupValue("detector.maxDetectionAge", m_settings.m_maxDetectionAge);
+
+            if (m_settings.m_maxDetectionAge < 1)
+            {
+                cerr << "Error: detector.maxDetectionAge has to be at least 1." << endl;
+                return PROGRAM_EXIT;
+            }
+
             // showOutput
             if (!m_showOutputSet)
                 m_cfg.lookupValue("showOutput", m_settings.m_showOutput);
@@ -358,6 +431,55 @@ namespace tld
             if (!m_useDsstTrackerSet)
                 m_cfg.lookupValue("useDsstTracker", m_settings.m_useDsstTracker);
 
+            // kernelType
+            string kernelType;
+
+            if (m_cfg.lookupValue("tracker.kernelType", kernelType))
+            {
+                if (kernelType.compare("gaussian") == 0)
+                    m_settings.m_kernelType = cf_tracking::KcfParameters::GAUSSIAN_KERNEL;
+                else if (kernelType.compare("polynomial") == 0)
+                    m_settings.m_kernelType = cf_tracking::KcfParameters::POLYNOMIAL_KERNEL;
+                else if (kernelType.compare("linear") == 0)
+                    m_settings.m_kernelType = cf_tracking::KcfParameters::LINEAR_KERNEL;
+                else
+                {
+                    cerr << "Error: tracker.kernelType has to be one of gaussian, polynomial, linear." << endl;
+                    return PROGRAM_EXIT;
+                }
+            }
+
+            // fastDsst
+            m_cfg.lookupValue("tracker.fastDsst", m_settings.m_fastDsst);
+
+            // kcfFeatures, dsstFeatures
+            if (!lookupFeatures(m_cfg, "tracker.kcfFeatures", m_settings.m_kcfFeatures)
+                || !lookupFeatures(m_cfg, "tracker.dsstFeatures", m_settings.m_dsstFeatures))
+                return PROGRAM_EXIT;
+
+            // translationUpdateInterval, scaleUpdateInterval, stableUpdatePsr
+            m_cfg.lookupValue("tracker.translationUpdateInterval", m_settings.m_translationUpdateInterval);
+            m_cfg.lookupValue("tracker.scaleUpdateInterval", m_settings.m_scaleUpdateInterval);
+            m_cfg.lookupValue("tracker.stableUpdatePsr", m_settings.m_stableUpdatePsr);
+
+            if (m_settings.m_translationUpdateInterval < 1 || m_settings.m_scaleUpdateInterval < 1)
+            {
+                cerr << "Error: tracker.translationUpdateInterval and tracker.scaleUpdateInterval have to be at least 1." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            // colorNamesTable
+            m_cfg.lookupValue("tracker.colorNamesTable", m_settings.m_colorNamesTablePath);
+
+            int features = (m_settings.m_useDsstTracker ? m_settings.m_dsstFeatures : m_settings.m_kcfFeatures);
+
+            if (features == cf_tracking::COLOR_NAMES_FEATURES
+                && !cf_tracking::loadColorNamesTable(m_settings.m_colorNamesTablePath, m_settings.m_colorNamesTable))
+            {
+                cerr << "Error: could not load tracker.colorNamesTable \"" << m_settings.m_colorNamesTablePath << "\"." << endl;
+                return PROGRAM_EXIT;
+            }
+
             // saveDir
             m_cfg.lookupValue("saveDir", m_settings.m_outputDir);
 
@@ -378,6 +500,64 @@ namespace tld
             // seed
             m_cfg.lookupValue("seed", m_settings.m_seed);
 
+            // targetRate
+            if (!m_targetRateSet)
+                m_cfg.lookupValue("targetRate", m_settings.m_targetRate);
+
+            if (m_settings.m_targetRate < 0.0f)
+            {
+                cerr << "Error: targetRate must not be negative." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            // maxFrameGap
+            m_cfg.lookupValue("tracker.maxFrameGap", m_settings.m_maxFrameGap);
+
+            if (m_settings.m_maxFrameGap < 0)
+            {
+                cerr << "Error: tracker.maxFrameGap must not be negative." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            // visualizationRate
+            m_cfg.lookupValue("visualizationRate", m_settings.m_visualizationRate);
+
+            if (m_settings.m_visualizationRate < 0.0f)
+            {
+                cerr << "Error: visualizationRate must not be negative." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            // governor
+            m_cfg.lookupValue("governor.budget", m_settings.m_governorBudget);
+            m_cfg.lookupValue("governor.headroom", m_settings.m_governorHeadroom);
+            m_cfg.lookupValue("governor.window", m_settings.m_governorWindow);
+            m_cfg.lookupValue("governor.scales", m_settings.m_governorScales);
+
+            if (m_settings.m_governorBudget < 0.0f)
+            {
+                cerr << "Error: governor.budget must not be negative." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            if (m_settings.m_governorHeadroom <= 0.0f || m_settings.m_governorHeadroom >= 1.0f)
+            {
+                cerr << "Error: governor.headroom must be between 0 and 1." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            if (m_settings.m_governorWindow < 1)
+            {
+                cerr << "Error: governor.window must be positive." << endl;
+                return PROGRAM_EXIT;
+            }
+
+            if (m_settings.m_governorScales < 1)
+            {
+                cerr << "Error: governor.scales must be positive." << endl;
+                return PROGRAM_EXIT;
+            }
+
             // initialBoundingBox
             try
             {
@@ -417,6 +597,34 @@ namespace tld
         main->tld->detectorEnabled = m_settings.m_detectorEnabled;
         std::cout << "m_settings.m_detectorEnabled: " << m_settings.m_detectorEnabled << std::endl;
 
+        main->tld->kcfParameters.kernelType = m_settings.m_kernelType;
+        std::cout << "m_settings.m_kernelType: " << m_settings.m_kernelType << std::endl;
+
+        main->tld->dsstParameters.enableFastMode = m_settings.m_fastDsst;
+        std::cout << "m_settings.m_fastDsst: " << m_settings.m_fastDsst << std::endl;
+
+        main->tld->kcfFeatures = m_settings.m_kcfFeatures;
+        main->tld->dsstFeatures = m_settings.m_dsstFeatures;
+        std::cout << "m_settings.m_kcfFeatures: " << m_settings.m_kcfFeatures << std::endl;
+        std::cout << "m_settings.m_dsstFeatures: " << m_settings.m_dsstFeatures << std::endl;
+
+        main->tld->kcfParameters.translationUpdateInterval = m_settings.m_translationUpdateInterval;
+        main->tld->kcfParameters.scaleUpdateInterval = m_settings.m_scaleUpdateInterval;
+        main->tld->kcfParameters.stableUpdatePsr = m_settings.m_stableUpdatePsr;
+        main->tld->dsstParameters.translationUpdateInterval = m_settings.m_translationUpdateInterval;
+        main->tld->dsstParameters.scaleUpdateInterval = m_settings.m_scaleUpdateInterval;
+        main->tld->dsstParameters.stableUpdatePsr = m_settings.m_stableUpdatePsr;
+        std::cout << "m_settings.m_translationUpdateInterval: " << m_settings.m_translationUpdateInterval << std::endl;
+        std::cout << "m_settings.m_scaleUpdateInterval: " << m_settings.m_scaleUpdateInterval << std::endl;
+        std::cout << "m_settings.m_stableUpdatePsr: " << m_settings.m_stableUpdatePsr << std::endl;
+
+        if (!m_settings.m_colorNamesTable.empty())
+        {
+            std::shared_ptr<const cv::Mat> table(new cv::Mat(m_settings.m_colorNamesTable));
+            main->tld->kcfParameters.colorNamesTable = table;
+            main->tld->dsstParameters.colorNamesTable = table;
+        }
+
         main->tld->init(m_settings.m_useDsstTracker);
         std::cout << "m_settings.m_useDsstTracker: " << m_settings.m_useDsstTracker << std::endl;
 
@@ -448,6 +656,9 @@ namespace tld
         main->seed = m_settings.m_seed;
         std::cout << "m_settings.m_seed: " << m_settings.m_seed << std::endl;
 
+        main->visualizationRate = m_settings.m_visualizationRate;
+        std::cout << "m_settings.m_visualizationRate: " << m_settings.m_visualizationRate << std::endl;
+
         if (m_settings.m_method == IMACQ_ROS) {
             main->isRosUsed = true;
         }
@@ -487,6 +698,18 @@ namespace tld
         detectorCascade->minSize = m_settings.m_minSize;
         std::cout << "m_settings.m_minSize: " << m_settings.m_minSize << std::endl;
 
+        detectorCascade->pyramidLevels = m_settings.m_detectorPyramidLevels;
+        std::cout << "m_settings.m_detectorPyramidLevels: " << m_settings.m_detectorPyramidLevels << std::endl;
+
+        detectorCascade->pyramidMinSize = m_settings.m_detectorPyramidMinSize;
+        std::cout << "m_settings.m_detectorPyramidMinSize: " << m_settings.m_detectorPyramidMinSize << std::endl;
+
+        main->tld->asyncDetection = m_settings.m_asyncDetection;
+        std::cout << "m_settings.m_asyncDetection: " << m_settings.m_asyncDetection << std::endl;
+
+        main->tld->maxDetectionAge = m_settings.m_maxDetectionAge;
+        std::cout << "m_settings.m_maxDetectionAge: " << m_settings.m_maxDetectionAge << std::endl;
+
         detectorCascade->numTrees = m_settings.m_numTrees;
         std::cout << "m_settings.m_numTrees: " << m_settings.m_numTrees << std::endl;
 
@@ -503,7 +726,30 @@ namespace tld
 
         std::cout << "ros depth setting: " << m_settings.depth_topic << std::endl;
 
-        std::cout << "frame modulo setting: " << m_settings.frame_modulo << std::endl;
+        std::cout << "m_settings.m_syncRgbd: " << m_settings.m_syncRgbd << std::endl;
+        std::cout << "m_settings.m_maxSkew: " << m_settings.m_maxSkew << std::endl;
+        std::cout << "m_settings.m_syncQueueSize: " << m_settings.m_syncQueueSize << std::endl;
+
+        main->scheduler.targetRate = m_settings.m_targetRate;
+        std::cout << "m_settings.m_targetRate: " << m_settings.m_targetRate << std::endl;
+
+        main->tld->maxFrameGap = m_settings.m_maxFrameGap;
+        std::cout << "m_settings.m_maxFrameGap: " << m_settings.m_maxFrameGap << std::endl;
+
+        main->governor.budget = m_settings.m_governorBudget;
+        std::cout << "m_settings.m_governorBudget: " << m_settings.m_governorBudget << std::endl;
+
+        main->governor.headroom = m_settings.m_governorHeadroom;
+        std::cout << "m_settings.m_governorHeadroom: " << m_settings.m_governorHeadroom << std::endl;
+
+        main->governor.window = m_settings.m_governorWindow;
+        std::cout << "m_settings.m_governorWindow: " << m_settings.m_governorWindow << std::endl;
+
+        main->governor.reducedScales = m_settings.m_governorScales;
+        std::cout << "m_settings.m_governorScales: " << m_settings.m_governorScales << std::endl;
+
+        // the configured modes are the ones the governor restores
+        main->governor.setBaseline(*main->tld);
 
         return SUCCESS;
     }
@@ -90,6 +90,7 @@ namespace tld
         bool m_initialBBSet;
         bool m_showOutputSet;
         bool m_useDsstTrackerSet;
+        bool m_targetRateSet;
         ///@}
     };
 
@@ -0,0 +1,96 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+#include <ros/ros.h>
+
+namespace tld
+{
+    FrameScheduler::FrameScheduler() :
+        targetRate(0),
+        lastFrameNr(-1),
+        nextDue(Clock::now()),
+        statisticsStart(Clock::now()),
+        numProcessed(0),
+        numDropped(0),
+        ageSum(0),
+        ageMax(0)
+    {
+    }
+
+    bool FrameScheduler::shouldProcess()
+    {
+        if (targetRate <= 0)
+            return true;
+
+        Clock::time_point now = Clock::now();
+        Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetRate));
+
+        // frames arrive with jitter, a frame a quarter period early is still taken
+        if (now < nextDue - period / 4)
+            return false;
+
+        nextDue += period;
+
+        // resynchronise after a pause instead of catching up
+        if (nextDue < now)
+            nextDue = now + period;
+
+        return true;
+    }
+
+    int FrameScheduler::processed(int frameNr, double age)
+    {
+        int gap = 0;
+
+        if (lastFrameNr >= 0)
+            gap = frameNr - lastFrameNr - 1;
+
+        lastFrameNr = frameNr;
+        numProcessed++;
+        numDropped += gap;
+        ageSum += age;
+        ageMax = std::max(ageMax, age);
+
+        return gap;
+    }
+
+    void FrameScheduler::logStatistics()
+    {
+        Clock::time_point now = Clock::now();
+
+        if (now - statisticsStart < std::chrono::seconds(1))
+            return;
+
+        if (numProcessed > 0)
+        {
+            ROS_DEBUG("Frames: %u processed, %u dropped, age mean %f s, max %f s",
+                      numProcessed, numDropped, ageSum / numProcessed, ageMax);
+        }
+
+        statisticsStart = now;
+        numProcessed = 0;
+        numDropped = 0;
+        ageSum = 0;
+        ageMax = 0;
+    }
+} /* namespace tld */
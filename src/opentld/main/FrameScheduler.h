@@ -0,0 +1,71 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef FRAMESCHEDULER_H_
+#define FRAMESCHEDULER_H_
+
+#include <chrono>
+
+namespace tld
+{
+    /**
+     * Decides which of the incoming frames are processed. The processing loop always takes
+     * the newest frame, frames that arrive while it is busy are dropped. Optionally the
+     * processing rate is limited to targetRate.
+     */
+    class FrameScheduler
+    {
+    public:
+        FrameScheduler();
+
+        /**
+         * Maximum number of processed frames per second; 0 processes every newest frame
+         */
+        double targetRate;
+
+        /**
+         * Returns true if a frame that arrives now should be processed
+         */
+        bool shouldProcess();
+
+        /**
+         * Records that frame frameNr was processed. Frame numbers must increase by one per received frame.
+         * @param age seconds between the capture of the frame and the start of its processing
+         * @return the number of frames skipped since the previously processed frame
+         */
+        int processed(int frameNr, double age);
+
+        /**
+         * Logs the processed and dropped frames and the frame age about once a second
+         */
+        void logStatistics();
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        int lastFrameNr;
+        Clock::time_point nextDue;
+        Clock::time_point statisticsStart;
+        unsigned int numProcessed;
+        unsigned int numDropped;
+        double ageSum;
+        double ageMax;
+    };
+} /* namespace tld */
+#endif /* FRAMESCHEDULER_H_ */
@@ -41,12 +41,65 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <people_msgs/People.h>
 #include <people_msgs/Person.h>
+#include <std_msgs/Float64.h>
+#include <std_msgs/UInt8.h>
 
 using namespace tld;
 using namespace cv;
 
 bool stop = false;
 
+Main::~Main()
+{
+    // the grabbers outlive doWork, the visualizer of doWork may still use them while it shuts down
+    delete ros_grabber;
+    delete ros_grabber_depth;
+    delete targets;
+    delete tld;
+    if (imAcq != NULL)
+        imAcqFree(imAcq);
+    delete config;
+}
+
+int Main::init(int argc, char **argv, const ros::NodeHandle &node_handle)
+{
+    config = new Config();
+    imAcq = imAcqAlloc();
+
+    if (config->init(argc, argv) == PROGRAM_EXIT)
+    {
+        return PROGRAM_EXIT;
+    }
+
+    config->configure(this);
+
+    if (isRosUsed) {
+        const Settings &settings = config->m_settings;
+        ros_grabber = new ROSGrabber(settings.color_topic, node_handle);
+        ros_grabber_depth = new ROSGrabberDepth(settings.depth_topic, node_handle, !settings.m_syncRgbd);
+        if (settings.m_syncRgbd) {
+            ros_grabber->synchronize(ros_grabber_depth, settings.depth_topic,
+                                     settings.m_maxSkew, settings.m_syncQueueSize);
+        }
+        ROS_DEBUG(">>> Finished ROS init");
+    }
+
+    tld->seed = seed;
+    imAcqInit(imAcq);
+
+    return SUCCESS;
+}
+
+void Main::requestStop()
+{
+    stopRequested = true;
+}
+
+bool Main::isStopped()
+{
+    return stop || stopRequested;
+}
+
 bool Main::toggleCB(clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Request& request, clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Response& response) {
     ROS_INFO("Received toggle service call");
     toggleMutex.lock();
@@ -68,6 +121,55 @@ bool Main::toggleCB(clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Reque
     return true;
 }
 
+bool Main::addTargetCB(clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Request& request, clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Response& response) {
+    ROS_INFO("Received add target service call");
+    if (request.roi.width == 0 || request.roi.height == 0) {
+        ROS_WARN("Ignoring additional target (invalid BB)!");
+        return true;
+    }
+
+    // the frames are consumed by the processing loop only, which initialises the target on its next frame
+    Rect bb(request.roi.x_offset, request.roi.y_offset, request.roi.width, request.roi.height);
+    targetsMutex.lock();
+    pendingTargets.push_back(bb);
+    targetsMutex.unlock();
+    return true;
+}
+
+bool Main::removeTargetCB(clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Request& request, clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Response& response) {
+    ROS_INFO("Received remove target service call");
+    targetsMutex.lock();
+    if (request.roi.width == 0 || request.roi.height == 0) {
+        ROS_INFO("Removing all additional targets");
+        targets->clear();
+        pendingTargets.clear();
+    } else {
+        // the target that currently overlaps the roi most is removed
+        Rect bb(request.roi.x_offset, request.roi.y_offset, request.roi.width, request.roi.height);
+        int id = targets->findTarget(bb);
+        if (id >= 0 && targets->removeTarget(id)) {
+            ROS_INFO("Removed target %d", id);
+        } else {
+            ROS_WARN("No target overlaps the given BB");
+        }
+    }
+    targetsMutex.unlock();
+    return true;
+}
+
+void Main::grabRosFrames(Mat *colorImage, Mat *depthImage, ros::Time *stamp) {
+    ros_grabber->getFrame(&rosFrame);
+    *colorImage = rosFrame.image;
+    *stamp = rosFrame.stamp;
+    if (ros_grabber->isSynchronized()) {
+        // depth image taken at (nearly) the same time as the colour image
+        *depthImage = rosFrame.depth;
+        ros_grabber_depth->setFrame(rosFrame.depth_frame_id, rosFrame.depth_stamp);
+    } else {
+        ros_grabber_depth->getImage(depthImage);
+    }
+}
+
 void inthand(int signum) {
     printf(">> CTRL+C...\n");
     stop = true;
@@ -75,38 +177,53 @@ void inthand(int signum) {
 
 void Main::doWork() {
 
-    signal(SIGINT, inthand);
+    if (!isNodelet) {
+        signal(SIGINT, inthand);
+    }
 
     Trajectory trajectory;
 
     Mat colorImage, depthImage;
 
     ROS_INFO(">>> Setting up ros subcribers");
-    image_transport::ImageTransport it(ros_grabber->node_handle_);
-    image_transport::Publisher pub = it.advertise("cftld/detection", 1);
     ros::Publisher pub_detection = ros_grabber_depth->node_handle_.advertise<people_msgs::People>("/cftld/sensor/person_to_follow", 1);
-    ros::Publisher pub_marker_array = ros_grabber_depth->node_handle_.advertise<visualization_msgs::MarkerArray>("/cftld/marker_array", 1);
+    // debug image and markers, rendered off the tracking thread
+    ROSVisualizer visualizer(ros_grabber_depth->node_handle_, ros_grabber_depth, visualizationRate);
+    // seconds from the camera stamp of a frame until its detections are published
+    ros::Publisher pub_latency = ros_grabber_depth->node_handle_.advertise<std_msgs::Float64>("/cftld/latency", 1);
+    // level of tld::QualityGovernor, latched so that late subscribers see the current one
+    ros::Publisher pub_quality = ros_grabber_depth->node_handle_.advertise<std_msgs::UInt8>("/cftld/quality_level", 1, true);
+    if (governor.budget > 0) {
+        std_msgs::UInt8 quality;
+        quality.data = static_cast<uint8_t>(governor.level());
+        pub_quality.publish(quality);
+    }
     ROS_INFO(">>> Subscribers initialized");
 
     std::string toggleServiceTopic = "/cftld/toggle";
     ros::ServiceServer serviceCrowd = ros_grabber_depth->node_handle_.advertiseService(toggleServiceTopic, &Main::toggleCB, this);
+    ros::ServiceServer serviceAddTarget = ros_grabber_depth->node_handle_.advertiseService("/cftld/add_target", &Main::addTargetCB, this);
+    ros::ServiceServer serviceRemoveTarget = ros_grabber_depth->node_handle_.advertiseService("/cftld/remove_target", &Main::removeTargetCB, this);
+
+    // Callbacks run on their own threads, so a new frame wakes the processing loop right away.
+    // A nodelet's callbacks are served by the threads of its manager.
+    ros::AsyncSpinner spinner(2);
+    if (!isNodelet) {
+        spinner.start();
+    }
+    ros::Time frameStamp;
 
     if (!isRosUsed) {
         printf(">> ROS IS OFF\n");
         colorImage = imAcqGetImg(imAcq);
     } else {
         ROS_DEBUG(">>> ROS IS ON");
-        // first spin, to get callback in the queue
-        ros::spinOnce();
-        ros_grabber->getImage(&colorImage);
-        ros_grabber_depth->getImage(&depthImage);
+        grabRosFrames(&colorImage, &depthImage, &frameStamp);
         while (colorImage.rows*colorImage.cols < 1 || depthImage.rows * depthImage.cols < 1) {
-            ros::spinOnce();
-            ros_grabber->getImage(&colorImage);
-            ros_grabber_depth->getImage(&depthImage);
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            ros_grabber->waitForFrame(last_frame_nr, 100);
             last_frame_nr = ros_grabber->getLastFrameNr();
-            if (stop) {
+            grabRosFrames(&colorImage, &depthImage, &frameStamp);
+            if (isStopped()) {
                 break;
             }
         }
@@ -127,7 +244,8 @@ void Main::doWork() {
         resultsFile = fopen(printResults, "w");
         if (!resultsFile) {
             fprintf(stderr, "Error: Unable to create results-file \"%s\"\n", printResults);
-            exit(-1);
+            requestStop();
+            return;
         }
     }
 
@@ -151,55 +269,71 @@ void Main::doWork() {
     // imAcqHasMoreFrames(imAcq)
     tic_global = static_cast<double>(getTickCount());
     unsigned int pubFrameCount = 0;
-    while (stop == false) {
-        // Loop spinner
-        ros::spinOnce();
-        // Make sure we only run with image framerate to save CPU cycles
+    double latencySum = 0;
+    double latencyMax = 0;
+    while (!isStopped()) {
+        // Make sure we only run with image framerate to save CPU cycles. The timeout only keeps the loop responsive to CTRL+C.
         if(isRosUsed) {
-            if(!(ros_grabber->getLastFrameNr() != last_frame_nr)) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                last_frame_nr = ros_grabber->getLastFrameNr();
-                // ROS_DEBUG(">>> Skipping computation step ...");
+            if(!ros_grabber->waitForFrame(last_frame_nr, 100)) {
                 continue;
             }
+            last_frame_nr = ros_grabber->getLastFrameNr();
+        }
+        targetsMutex.lock();
+        bool hasTargets = targets->numberOfTargets() > 0 || !pendingTargets.empty();
+        targetsMutex.unlock();
+
+        toggleMutex.lock();
+        bool toggled = isToggeled;
+        bool passNewBB = newBB;
+        Rect newBox;
+        if (newBB) {
+            newBox = tldArrayToRect(initialBB);
+            newBB = false;
         }
-        if(isToggeled) {
+        toggleMutex.unlock();
+
+        if(toggled || hasTargets) {
 
             toc_global = static_cast<double>(getTickCount()) - tic_global;
             
+            scheduler.logStatistics();
+
             if (static_cast<float>(toc_global)/getTickFrequency() >= 1) {
                 ROS_DEBUG("Passed time: %f", static_cast<float>(toc_global)/getTickFrequency());
                 ROS_DEBUG("FPS: %d", pubFrameCount);
+                if (pubFrameCount > 0) {
+                    ROS_DEBUG("Latency: mean %f s, max %f s", latencySum / pubFrameCount, latencyMax);
+                }
                 pubFrameCount = 0;
+                latencySum = 0;
+                latencyMax = 0;
                 tic_global = static_cast<double>(getTickCount());
             }
 
-            if (newBB) {
+            if (passNewBB) {
                 if (!isRosUsed) {
                     colorImage.release();
                     colorImage = imAcqGetImg(imAcq);
                 } else {
-                    ros_grabber->getImage(&colorImage);
-                    ros_grabber_depth->getImage(&depthImage);
+                    grabRosFrames(&colorImage, &depthImage, &frameStamp);
                     //cv::resize(colorImage, colorImage, cv::Size(), 0.375, 0.375);
-                    last_frame_nr = ros_grabber->getLastFrameNr();
                 }
 
                 ROS_INFO("---> Passing new bounding box to tld");
-                Rect bb = tldArrayToRect(initialBB);
+                Rect bb = newBox;
                 tic = static_cast<double>(getTickCount());
                 tld->selectObject(colorImage, &bb);
                 toc = (static_cast<double>(getTickCount()) - tic)/static_cast<float>(getTickFrequency());
                 skipProcessingOnce = true;
                 reuseFrameOnce = true;
                 ROS_DEBUG("---> Re-init of bounding box took %f seconds", toc);
-                
-                newBB = false;
             }
 
-	        if (ros_grabber->getLastFrameNr() % frame_modulo == 0) {
+            // the newest frame, unless that would exceed the target rate
+	        if (scheduler.shouldProcess()) {
 
-                ROS_DEBUG("\tProcessing image with frame nr: %d", ros_grabber->getLastFrameNr());
+                int frameGap = 0;
 
                 if (!reuseFrameOnce && (!paused || step)) {
 
@@ -207,10 +341,11 @@ void Main::doWork() {
                         colorImage.release();
                         colorImage = imAcqGetImg(imAcq);
                     } else {
-                        ros_grabber->getImage(&colorImage);
-                        ros_grabber_depth->getImage(&depthImage);
+                        grabRosFrames(&colorImage, &depthImage, &frameStamp);
+                        // seq is counted by the grabber, header.seq is not set for intra-process messages
+                        frameGap = scheduler.processed(rosFrame.seq, (ros::Time::now() - frameStamp).toSec());
+                        ROS_DEBUG("\tProcessing image with frame nr: %d, %d frames skipped", rosFrame.seq, frameGap);
                         //cv::resize(colorImage, colorImage, cv::Size(), 0.375, 0.375);
-                        last_frame_nr = ros_grabber->getLastFrameNr();
                     }
 
                     if (colorImage.channels() == 1)
@@ -224,8 +359,44 @@ void Main::doWork() {
 
                 if (!skipProcessingOnce && (!paused || step)) {
                     tic = static_cast<double>(getTickCount());
-                    tld->processImage(colorImage);
+                    targetsMutex.lock();
+                    for (size_t i = 0; i < pendingTargets.size(); i++) {
+                        int id = targets->addTarget(colorImage, pendingTargets[i]);
+                        if (id < 0) {
+                            ROS_WARN("Could not add target x: %d, y: %d, w: %d, h: %d", pendingTargets[i].x, pendingTargets[i].y, pendingTargets[i].width, pendingTargets[i].height);
+                        } else {
+                            // the number of scales of a new tracker is the configured one
+                            governor.apply(targets->target(id));
+                            ROS_INFO("Tracking additional target %d", id);
+                        }
+                    }
+                    pendingTargets.clear();
+                    // lets the trackers handle frames skipped since the previous processed one
+                    tld->frameGap = frameGap;
+                    targets->setFrameGap(frameGap);
+                    if (targets->numberOfTargets() > 0) {
+                        // shares the frame preprocessing with the additional targets
+                        targets->processImage(colorImage, toggled ? tld : NULL);
+                    } else {
+                        tld->processImage(colorImage);
+                    }
                     toc = static_cast<double>(getTickCount()) - tic;
+
+                    // trades quality for time if processing the frame exceeded the budget
+                    if (governor.update(toc / getTickFrequency())) {
+                        governor.apply(tld);
+                        std::vector<int> ids = targets->targetIds();
+                        for (size_t i = 0; i < ids.size(); i++) {
+                            governor.apply(targets->target(ids[i]));
+                        }
+                        ROS_INFO("Quality level %d (%s), mean processing time %f s, budget %f s", governor.level(),
+                                 tld::QualityGovernor::levelName(governor.level()), governor.lastMean(), governor.budget);
+
+                        std_msgs::UInt8 quality;
+                        quality.data = static_cast<uint8_t>(governor.level());
+                        pub_quality.publish(quality);
+                    }
+                    targetsMutex.unlock();
                 }
                 else {
                     skipProcessingOnce = false;
@@ -259,15 +430,25 @@ void Main::doWork() {
                     sprintf(string, "#%d, fps: %.2f, #numwin:%d, %s", imAcq->currentFrame - 1,
                             fps, tld->detectorCascade->numWindows, learningString);
                     cv::Scalar yellow = cv::Scalar(0, 255, 255, 0);
-                    cv::Scalar black = cv::Scalar(0, 0, 0, 0);
-                    cv::Scalar white = cv::Scalar(255, 255, 255, 0);
                     cv::Scalar blue = cv::Scalar(255, 144, 30, 0);
 
                     people_msgs::People detections;
 
-                    if (tld->currBB != NULL) {
-                        cv::Scalar rectangleColor = blue;
-                        cv::rectangle(colorImage, tld->currBB->tl(), tld->currBB->br(), rectangleColor, 2, 8, 0);
+                    // the tracking thread only collects what to draw, rendering and the debug
+                    // publishers are left to the visualizer
+                    bool visualize = isRosUsed && visualizer.wantsFrame();
+                    bool drawOverlay = visualize || saveDir != NULL;
+                    VisualizationFrame visualization;
+                    if (drawOverlay) {
+                        visualization.image = colorImage;
+                        visualization.source = rosFrame.source;
+                        visualization.stamp = frameStamp;
+                        visualization.info = string;
+                    }
+
+                    if (toggled && tld->currBB != NULL) {
+                        if (drawOverlay)
+                            visualization.boxes.push_back({*tld->currBB, blue, ""});
                         geometry_msgs::PoseStamped pose = ros_grabber_depth->getDetectionPose(depthImage, tld->currBB);
                         if (pose.header.frame_id != "invalid") {
                             detections.header = pose.header;
@@ -276,51 +457,81 @@ void Main::doWork() {
                             person.position = pose.pose.position;
                             person.reliability = 1.0;
                             detections.people.push_back(person);
-                            ros_grabber_depth->createVisualisation(pose.pose, pub_marker_array);
+                            if (visualize)
+                                visualization.markers.push_back(pose.pose);
                         }
                     }
 
+                    targetsMutex.lock();
+                    std::vector<int> targetIds = targets->targetIds();
+                    for (size_t i = 0; i < targetIds.size(); i++) {
+                        TLD *target = targets->target(targetIds[i]);
+                        if (target->currBB == NULL)
+                            continue;
+
+                        std::string targetName = "target_" + std::to_string(targetIds[i]);
+                        if (drawOverlay)
+                            visualization.boxes.push_back({*target->currBB, yellow, targetName});
+                        geometry_msgs::PoseStamped pose = ros_grabber_depth->getDetectionPose(depthImage, target->currBB);
+                        if (pose.header.frame_id != "invalid") {
+                            detections.header = pose.header;
+                            people_msgs::Person person;
+                            person.name = targetName;
+                            person.position = pose.pose.position;
+                            person.reliability = 1.0;
+                            detections.people.push_back(person);
+                        }
+                    }
+                    targetsMutex.unlock();
+
                     if (pub_detection.getNumSubscribers() > 0) {
                         pub_detection.publish(detections);
                     }
-                    cv::putText(colorImage, string, cv::Point(15, 15), cv::FONT_HERSHEY_SIMPLEX, 0.4, blue, 1, 8);
-                    pubFrameCount++;;
 
-                    // Publish every 6th cycle
-                    if (pub.getNumSubscribers() > 0 and last_frame_nr % 6 == 0) {
-                        sensor_msgs::ImagePtr msg = cv_bridge::CvImage(std_msgs::Header(), "bgr8", colorImage).toImageMsg();
-                        pub.publish(msg);
+                    if (isRosUsed) {
+                        std_msgs::Float64 latency;
+                        latency.data = (ros::Time::now() - frameStamp).toSec();
+                        pub_latency.publish(latency);
+                        latencySum += latency.data;
+                        latencyMax = std::max(latencyMax, latency.data);
                     }
+                    pubFrameCount++;;
 
                     if (saveDir != NULL) {
+                        Mat overlay;
+                        ROSVisualizer::render(visualization, &overlay);
                         char fileName[256];
                         sprintf(fileName, "%s/%.5d.png", saveDir, imAcq->currentFrame - 1);
-                        cv::imwrite(fileName, colorImage);
+                        cv::imwrite(fileName, overlay);
+                    }
+
+                    if (visualize) {
+                        visualizer.submit(visualization);
                     }
 		        }
-            // frame % 2 == 0
             } else {
-                ROS_DEBUG("\tOmitting frame with id: %d", ros_grabber->getLastFrameNr());
-                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                ROS_DEBUG("\tSkipping frame with id: %d to keep the target rate", last_frame_nr);
             }
 
+	    } else if (!isRosUsed) {
+	        // nothing to track and no frame to wait for
+	        std::this_thread::sleep_for(std::chrono::milliseconds(20));
 	    } // is toggle
 
-	    std::this_thread::sleep_for(std::chrono::milliseconds(20));
-
         if (reuseFrameOnce) {
             reuseFrameOnce = false;
         }
     
-        if(stop) { break; }
+        if(isStopped()) { break; }
     }
 
     ROS_INFO(">>> Bye Bye!");
 
+    if (!isNodelet) {
+        spinner.stop();
+    }
+
     colorImage.release();
-    
-    delete ros_grabber;
-    delete ros_grabber_depth;
 
     if (resultsFile) {
         fclose(resultsFile);
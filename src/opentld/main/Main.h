@@ -27,17 +27,28 @@
 #ifndef MAIN_H_
 #define MAIN_H_
 
+#include <atomic>
+
 #include "TLD.h"
+#include "MultiTLD.h"
 #include "ImAcq.h"
+#include "FrameScheduler.h"
+#include "QualityGovernor.h"
 #include "cf_tracker.hpp"
 
 // ROS
 #include "ros/ros_grabber.hpp"
 #include "ros/ros_grabber_depth.hpp"
+#include "ros/ros_visualizer.hpp"
 #include <ros/service_server.h>
 #include <std_srvs/Empty.h>
 #include <clf_perception_vision_msgs/ToggleCFtldTrackingWithBB.h>
 
+namespace tld
+{
+class Config;
+}
+
 enum Retval
 {
     PROGRAM_EXIT = 0,
@@ -48,9 +59,19 @@ class Main
 {
 public:
     tld::TLD *tld;
+    // additional targets, configured like tld and processed on the same frames
+    tld::MultiTLD *targets;
+    // boxes from /cftld/add_target, initialised by the processing loop on its next frame
+    std::vector<cv::Rect> pendingTargets;
+    std::mutex targetsMutex;
     ImAcq *imAcq;
+    // owns the settings strings that printResults and saveDir point into
+    tld::Config *config;
     ROSGrabber *ros_grabber;
     ROSGrabberDepth *ros_grabber_depth;
+    // ROS frame currently processed, keeps the message data of the images alive
+    StampedFrame rosFrame;
+    double visualizationRate;
     std::mutex  toggleMutex;
     bool isToggeled;
     bool newBB;
@@ -67,17 +88,35 @@ public:
     bool exportModelAfterRun;
     bool loadModel;
     bool isRosUsed;
+    // running inside a nodelet manager, which owns signal handling and the callback threads
+    bool isNodelet;
+    std::atomic<bool> stopRequested;
     const char *modelPath;
     const char *modelExportFile;
     int seed;
     int last_frame_nr;
-    unsigned int frame_modulo;
+    tld::FrameScheduler scheduler;
+    tld::QualityGovernor governor;
 
     bool toggleCB(clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Request& request, clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Response& response);
+    bool addTargetCB(clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Request& request, clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Response& response);
+    bool removeTargetCB(clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Request& request, clf_perception_vision_msgs::ToggleCFtldTrackingWithBB::Response& response);
+    // parses the arguments and the config file and sets up the grabbers on node_handle
+    int init(int argc, char **argv, const ros::NodeHandle &node_handle);
+    // makes doWork return after the current frame; safe to call from any thread
+    void requestStop();
+    bool isStopped();
+    // takes the newest colour and depth image from the grabbers
+    void grabRosFrames(cv::Mat *colorImage, cv::Mat *depthImage, ros::Time *stamp);
 
     Main()
     {
         tld = new tld::TLD();
+        targets = new tld::MultiTLD([this]() {
+            tld::TLD *target = new tld::TLD();
+            target->initFrom(*tld);
+            return target;
+        });
         showOutput = 1;
         printResults = NULL;
         saveDir = ".";
@@ -104,15 +143,17 @@ public:
 
         modelPath = NULL;
         imAcq = NULL;
+        config = NULL;
+        ros_grabber = NULL;
+        ros_grabber_depth = NULL;
+        isNodelet = false;
+        stopRequested = false;
 
         last_frame_nr = -1;
+        visualizationRate = 5.0;
     }
 
-    ~Main()
-    {
-        delete tld;
-        imAcqFree(imAcq);
-    }
+    ~Main();
 
     void doWork();
 };
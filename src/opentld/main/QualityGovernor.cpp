@@ -0,0 +1,164 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include "QualityGovernor.h"
+
+#include "TLD.h"
+
+namespace tld
+{
+    QualityGovernor::QualityGovernor() :
+        budget(0),
+        headroom(0.7),
+        window(10),
+        recoverWindows(3),
+        reducedScales(17),
+        learningEnabled(true),
+        alternating(false),
+        detectorEnabled(true),
+        numberOfScales(0),
+        currLevel(FULL_QUALITY),
+        numFrames(0),
+        timeSum(0),
+        meanTime(0),
+        goodWindows(0)
+    {
+    }
+
+    void QualityGovernor::setBaseline(const TLD &tld)
+    {
+        learningEnabled = tld.learningEnabled;
+        alternating = tld.alternating;
+        detectorEnabled = tld.detectorEnabled;
+        numberOfScales = tld.numberOfScales();
+        currLevel = FULL_QUALITY;
+        numFrames = 0;
+        timeSum = 0;
+        goodWindows = 0;
+    }
+
+    bool QualityGovernor::hasEffect(int level) const
+    {
+        switch (level)
+        {
+        case REDUCED_SCALES:
+            return reducedScales < numberOfScales;
+        case NO_LEARNING:
+            return learningEnabled && detectorEnabled;
+        case DETECT_WHEN_LOST:
+            return !alternating && detectorEnabled;
+        case TRACKER_ONLY:
+            return detectorEnabled;
+        default:
+            return true;
+        }
+    }
+
+    bool QualityGovernor::update(double seconds)
+    {
+        if (budget <= 0)
+            return false;
+
+        timeSum += seconds;
+
+        if (++numFrames < window)
+            return false;
+
+        double mean = timeSum / numFrames;
+        numFrames = 0;
+        timeSum = 0;
+
+        int next = currLevel;
+
+        if (mean > budget)
+        {
+            goodWindows = 0;
+
+            do
+                next++;
+            while (next < NUM_LEVELS && !hasEffect(next));
+
+            // nothing left to switch off
+            if (next >= NUM_LEVELS)
+                return false;
+        }
+        else if (mean < headroom * budget && currLevel > FULL_QUALITY)
+        {
+            // the cheaper level measures the cost of a more expensive one only after switching back,
+            // so raising waits for several windows and a short spike does not cause oscillation
+            if (++goodWindows < recoverWindows)
+                return false;
+
+            goodWindows = 0;
+
+            do
+                next--;
+            while (next > FULL_QUALITY && !hasEffect(next));
+        }
+        else
+        {
+            goodWindows = 0;
+            return false;
+        }
+
+        currLevel = next;
+        meanTime = mean;
+        return true;
+    }
+
+    void QualityGovernor::apply(TLD *tld) const
+    {
+        tld->learningEnabled = learningEnabled && currLevel < NO_LEARNING;
+        tld->alternating = alternating || currLevel >= DETECT_WHEN_LOST;
+        tld->detectorEnabled = detectorEnabled && currLevel < TRACKER_ONLY;
+
+        // rebuilds the scale filter, which is trained again at the next frame
+        if (hasEffect(REDUCED_SCALES))
+            tld->setNumberOfScales(currLevel >= REDUCED_SCALES ? reducedScales : numberOfScales);
+    }
+
+    int QualityGovernor::level() const
+    {
+        return currLevel;
+    }
+
+    const char *QualityGovernor::levelName(int level)
+    {
+        switch (level)
+        {
+        case FULL_QUALITY:
+            return "full quality";
+        case REDUCED_SCALES:
+            return "reduced scales";
+        case NO_LEARNING:
+            return "no learning";
+        case DETECT_WHEN_LOST:
+            return "detect when lost";
+        case TRACKER_ONLY:
+            return "tracker only";
+        default:
+            return "unknown";
+        }
+    }
+
+    double QualityGovernor::lastMean() const
+    {
+        return meanTime;
+    }
+} /* namespace tld */
@@ -0,0 +1,112 @@
+/*  Copyright 2011 AIT Austrian Institute of Technology
+*
+*   This file is part of OpenTLD.
+*
+*   OpenTLD is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   OpenTLD is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with OpenTLD.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef QUALITYGOVERNOR_H_
+#define QUALITYGOVERNOR_H_
+
+namespace tld
+{
+    class TLD;
+
+    /**
+     * Keeps the processing time of a frame within a budget. If the mean time of a window of
+     * frames exceeds the budget, the next level switches off a part of the TLD pipeline. After
+     * several windows that leave enough headroom, the previous level is restored.
+     */
+    class QualityGovernor
+    {
+    public:
+        enum Level
+        {
+            FULL_QUALITY,       //!< the configured pipeline
+            REDUCED_SCALES,     //!< the scale filter of the tracker searches fewer scales
+            NO_LEARNING,        //!< the model is no longer updated
+            DETECT_WHEN_LOST,   //!< the detector only runs if the tracker is lost
+            TRACKER_ONLY,       //!< the detector does not run
+            NUM_LEVELS
+        };
+
+        QualityGovernor();
+
+        /**
+         * Processing time per frame in seconds; 0 disables the governor
+         */
+        double budget;
+
+        /**
+         * The quality is raised if the mean time is below headroom * budget
+         */
+        double headroom;
+
+        /**
+         * Number of frames a decision is based on
+         */
+        int window;
+
+        /**
+         * Number of windows with enough headroom before the quality is raised
+         */
+        int recoverWindows;
+
+        /**
+         * Number of scales searched by the tracker from REDUCED_SCALES on
+         */
+        int reducedScales;
+
+        /**
+         * Remembers the modes and the number of scales of tld as the ones of FULL_QUALITY
+         */
+        void setBaseline(const TLD &tld);
+
+        /**
+         * Records the processing time of a frame in seconds.
+         * @return true if the level changed
+         */
+        bool update(double seconds);
+
+        /**
+         * Sets the modes of tld for the current level
+         */
+        void apply(TLD *tld) const;
+
+        int level() const;
+        static const char *levelName(int level);
+
+        /**
+         * Mean processing time of the window that caused the last change of level
+         */
+        double lastMean() const;
+
+    private:
+        // true if the level switches off something that is on in the baseline
+        bool hasEffect(int level) const;
+
+        bool learningEnabled;
+        bool alternating;
+        bool detectorEnabled;
+        int numberOfScales;
+
+        int currLevel;
+        int numFrames;
+        double timeSum;
+        double meanTime;
+        int goodWindows;
+    };
+} /* namespace tld */
+#endif /* QUALITYGOVERNOR_H_ */
@@ -42,6 +42,13 @@ namespace tld
         m_saveOutput(false),
         m_alternating(false),
         m_useDsstTracker(false),
+        m_kernelType(0),            // gaussian
+        m_fastDsst(false),
+        m_kcfFeatures(0),           // fhog
+        m_dsstFeatures(0),          // fhog
+        m_translationUpdateInterval(1),
+        m_scaleUpdateInterval(1),
+        m_stableUpdatePsr(20.0f),
         m_trajectory(0),
         m_method(IMACQ_CAM),
         m_startFrame(1),
@@ -53,13 +60,26 @@ namespace tld
         m_thetaP(0.55f),
         m_thetaN(0.5f),
         m_minSize(25),
+        m_detectorPyramidLevels(1),
+        m_detectorPyramidMinSize(60),
+        m_asyncDetection(false),
+        m_maxDetectionAge(3),
         m_camNo(0),
         m_fps(24),          // 24
         m_seed(0),
         m_threshold(0.7f),
         m_proportionalShift(0.1f),
         m_initialBoundingBox(vector<int>()),
-        frame_modulo(2)
+        m_targetRate(0),
+        m_maxFrameGap(5),
+        m_syncRgbd(false),
+        m_maxSkew(0.04f),
+        m_syncQueueSize(5),
+        m_visualizationRate(5.0f),
+        m_governorBudget(0),
+        m_governorHeadroom(0.7f),
+        m_governorWindow(10),
+        m_governorScales(17)
     {
     }
 
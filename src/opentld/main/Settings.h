@@ -55,6 +55,13 @@ namespace tld
         bool m_saveOutput; //!< specifies whether to save visual output
         bool m_alternating; //!< if set to true, detector is disabled while tracker is running.
         bool m_useDsstTracker;
+        int m_kernelType; //!< kernel of the KCF tracker; one of cf_tracking::KcfParameters::KernelType
+        bool m_fastDsst; //!< enables the fast mode of the DSST tracker
+        int m_kcfFeatures; //!< features of the KCF tracker; one of cf_tracking::FeatureType
+        int m_dsstFeatures; //!< features of the DSST tracker; one of cf_tracking::FeatureType
+        int m_translationUpdateInterval; //!< frames between translation filter updates while the tracker is stable
+        int m_scaleUpdateInterval; //!< frames between scale filter updates while the tracker is stable
+        float m_stableUpdatePsr; //!< minimum PSR of a stable tracker
         int m_trajectory; //!< specifies the number of the last frames which are considered by the trajectory; 0 disables the trajectory
         int m_method; //!< method of capturing: IMACQ_CAM, IMACQ_IMGS, IMACQ_VID, ROS
         int m_startFrame; //!< first frame of capturing
@@ -67,6 +74,10 @@ namespace tld
         float m_thetaN;
         int m_seed;
         int m_minSize; //!< minimum size of scanWindows
+        int m_detectorPyramidLevels; //!< number of image pyramid levels of the detector; 1 evaluates all windows at full resolution
+        int m_detectorPyramidMinSize; //!< scanWindows are evaluated on the coarsest pyramid level on which they are at least this large
+        bool m_asyncDetection; //!< the detector runs on its own thread one frame behind the tracker
+        int m_maxDetectionAge; //!< asynchronous detections of more frames ago do not reinitialise the tracker
         int m_camNo; //!< Which camera to use
         float m_fps; //!< Frames per second
         float m_threshold; //!< threshold for determining positive results
@@ -76,9 +87,20 @@ namespace tld
         std::string m_printResults; //!< path to the file were the results should be printed; NULL -> results will not be printed
         std::string m_printTiming; //!< path to the file were the timings should be printed; NULL -> results will not be printed
         std::vector<int> m_initialBoundingBox; //!< Initial Bounding Box can be specified here
+        std::string m_colorNamesTablePath; //!< color names lookup table; required if a tracker uses color names
+        cv::Mat m_colorNamesTable; //!< table loaded from m_colorNamesTablePath
         std::string depth_topic;
         std::string color_topic;
-        int frame_modulo;
+        float m_targetRate; //!< maximum number of processed frames per second; 0 always processes the newest frame
+        int m_maxFrameGap; //!< after more skipped frames the detector checks whether the target left the tracker's search window
+        bool m_syncRgbd; //!< pair colour and depth images by their time stamps instead of using the latest of each
+        float m_maxSkew; //!< maximum time difference in seconds between the images of a synchronized pair
+        int m_syncQueueSize; //!< number of images per stream kept to find the best matching pairs
+        float m_visualizationRate; //!< maximum rate in Hz of the debug image and markers; 0 disables them
+        float m_governorBudget; //!< processing time per frame in seconds above which parts of the pipeline are switched off; 0 disables the governor
+        float m_governorHeadroom; //!< the switched off parts are restored while the processing time is below this fraction of the budget
+        int m_governorWindow; //!< number of frames the processing time is averaged over
+        int m_governorScales; //!< number of scales searched by the tracker at the first reduced quality level
     };
 }
 
@@ -51,53 +51,147 @@ the use of this software, even if advised of the possibility of such damage.
 using namespace cv;
 using namespace std;
 
-ROSGrabber::ROSGrabber(std::string i_scope) : it_(node_handle_) {
+ROSGrabber::ROSGrabber(std::string i_scope, const ros::NodeHandle &node_handle) : node_handle_(node_handle), it_(node_handle_), scope(i_scope), sync_depth(NULL), sync(NULL) {
     image_sub_ = it_.subscribe(i_scope+"/image_raw", 1, &ROSGrabber::imageCallback, this);
     frame_nr = -1;
     pyr = 0;
+    colorReceived = 0;
+    depthReceived = 0;
+    pairsReceived = 0;
+    pairsDropped = 0;
+    skewSum = 0.0;
+    skewMax = 0.0;
     ROS_DEBUG(">>> ROS grabber init done");
     ROS_INFO(">>> ROS grabber RGB %s", i_scope.c_str());
 }
 
-ROSGrabber::~ROSGrabber() { }
+ROSGrabber::~ROSGrabber() {
+    delete sync;
+}
 
-void ROSGrabber::imageCallback(const sensor_msgs::ImageConstPtr &msg) {
-    cv_bridge::CvImagePtr cv_ptr;
+void ROSGrabber::synchronize(ROSGrabberDepth *depth, std::string depth_scope, double maxSkew, int queueSize) {
+    image_sub_.shutdown();
+    sync_depth = depth;
+
+    color_filter.subscribe(it_, scope+"/image_raw", queueSize);
+    depth_filter.subscribe(it_, depth_scope+"/image_raw", queueSize);
+    color_filter.registerCallback(boost::bind(&ROSGrabber::colorCountCallback, this, _1));
+    depth_filter.registerCallback(boost::bind(&ROSGrabber::depthCountCallback, this, _1));
+
+    SyncPolicy policy(queueSize);
+    policy.setMaxIntervalDuration(ros::Duration(maxSkew));
+    sync = new message_filters::Synchronizer<SyncPolicy>(policy, color_filter, depth_filter);
+    sync->registerCallback(boost::bind(&ROSGrabber::imagePairCallback, this, _1, _2));
+    ROS_INFO(">>> ROS grabber RGB-D synchronized with %s, max skew %.3fs", depth_scope.c_str(), maxSkew);
+}
+
+bool ROSGrabber::isSynchronized() {
+    return sync != NULL;
+}
+
+bool ROSGrabber::toFrame(const sensor_msgs::ImageConstPtr &msg, StampedFrame *frame) {
+    cv_bridge::CvImageConstPtr cv_ptr;
     try {
-        cv_ptr = cv_bridge::toCvCopy(msg, sensor_msgs::image_encodings::BGR8);
+        // shares the message data if it already is bgr8
+        cv_ptr = cv_bridge::toCvShare(msg, sensor_msgs::image_encodings::BGR8);
     }
     catch (cv_bridge::Exception &e) {
         ROS_ERROR("E >>> CV_BRIDGE exception: %s", e.what());
-        return;
+        return false;
     }
 
-    mtx.lock();
-    frame_time = msg->header.stamp;
-    frame_nr = (int)msg->header.seq;
-    frame_id = msg->header.frame_id;
-    source_frame = cv_ptr->image;
+    frame->stamp = msg->header.stamp;
+    frame->frame_id = msg->header.frame_id;
+    frame->source = cv_ptr;
     if (pyr > 0) {
-        cv::pyrUp(source_frame, output_frame, cv::Size(source_frame.cols*2, source_frame.rows*2));
+        // a new buffer, the previous image of this slot may still be in use by a consumer
+        frame->image = cv::Mat();
+        cv::pyrUp(cv_ptr->image, frame->image, cv::Size(cv_ptr->image.cols*2, cv_ptr->image.rows*2));
     } else {
-        output_frame = source_frame;
+        frame->image = cv_ptr->image;
     }
-    mtx.unlock();
+    return true;
 }
 
-void ROSGrabber::getImage(cv::Mat *mat) {
+bool ROSGrabber::publishFrame(StampedFrame *frame) {
+    // header.seq is not set for intra-process messages, so the frames are numbered here
     mtx.lock();
-    *mat = output_frame;
+    frame->seq = frame_nr + 1;
+    bool dropped = frames.publish();
+    frame_nr = frame->seq;
     mtx.unlock();
+    frameArrived.notify_all();
+    return dropped;
 }
 
-void ROSGrabber::setPyr(bool _pyr) {
-    pyr = _pyr;
+void ROSGrabber::imageCallback(const sensor_msgs::ImageConstPtr &msg) {
+    StampedFrame &frame = frames.writeBuffer();
+    if (toFrame(msg, &frame)) {
+        publishFrame(&frame);
+    }
+}
+
+void ROSGrabber::imagePairCallback(const sensor_msgs::ImageConstPtr &msg, const sensor_msgs::ImageConstPtr &depth_msg) {
+    StampedFrame &frame = frames.writeBuffer();
+    StampedFrame depth;
+    if (!toFrame(msg, &frame) || !sync_depth->toFrame(depth_msg, &depth)) {
+        return;
+    }
+    frame.depth = depth.image;
+    frame.depth_stamp = depth.stamp;
+    frame.depth_frame_id = depth.frame_id;
+    frame.depth_source = depth.source;
+
+    double skew = std::abs((frame.stamp - frame.depth_stamp).toSec());
+    pairsReceived++;
+    skewSum += skew;
+    skewMax = std::max(skewMax, skew);
+    if (publishFrame(&frame)) {
+        // the processing loop did not take the previous pair
+        pairsDropped++;
+    }
+
+    ROS_INFO_THROTTLE(10, ">>> RGB-D sync: %u pairs from %u colour / %u depth frames, %u pairs not processed, skew mean %.1fms max %.1fms",
+                      pairsReceived, (unsigned int)colorReceived, (unsigned int)depthReceived, pairsDropped,
+                      1000.0 * skewSum / pairsReceived, 1000.0 * skewMax);
+}
+
+void ROSGrabber::colorCountCallback(const sensor_msgs::ImageConstPtr &msg) {
+    colorReceived++;
 }
 
-ros::Time ROSGrabber::getTimestamp() {
-    return frame_time;
+void ROSGrabber::depthCountCallback(const sensor_msgs::ImageConstPtr &msg) {
+    depthReceived++;
+}
+
+bool ROSGrabber::getFrame(StampedFrame *frame) {
+    bool isNew = frames.update();
+    *frame = frames.readBuffer();
+    return isNew;
+}
+
+void ROSGrabber::getImage(cv::Mat *mat) {
+    StampedFrame frame;
+    getFrame(&frame);
+    *mat = frame.image;
+}
+
+void ROSGrabber::getImage(cv::Mat *mat, ros::Time *stamp) {
+    StampedFrame frame;
+    getFrame(&frame);
+    *mat = frame.image;
+    *stamp = frame.stamp;
+}
+
+bool ROSGrabber::waitForFrame(int lastFrameNr, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mtx);
+    return frameArrived.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return frame_nr != lastFrameNr; });
+}
+
+void ROSGrabber::setPyr(bool _pyr) {
+    pyr = _pyr;
 }
 
 int ROSGrabber::getLastFrameNr() {
     return frame_nr;
-}
\ No newline at end of file
+}
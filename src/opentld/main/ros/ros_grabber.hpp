@@ -52,11 +52,21 @@ the use of this software, even if advised of the possibility of such damage.
 #include <cv_bridge/cv_bridge.h>
 #include <sensor_msgs/image_encodings.h>
 #include <image_transport/image_transport.h>
+#include <image_transport/subscriber_filter.h>
+#include <message_filters/synchronizer.h>
+#include <message_filters/sync_policies/approximate_time.h>
+
+// SELF
+#include "stamped_frame.hpp"
+#include "ros_grabber_depth.hpp"
 
 // STD
+#include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <string>
 #include <sstream>
+#include <cmath>
 #include <iostream>
 
 // CV
@@ -69,23 +79,55 @@ the use of this software, even if advised of the possibility of such damage.
 class ROSGrabber {
 
 public:
-    ROSGrabber(std::string i_scope);
+    ROSGrabber(std::string i_scope, const ros::NodeHandle &node_handle = ros::NodeHandle());
     ~ROSGrabber();
+    // Replaces the colour subscription by approximate time synchronized RGB-D pairs, the depth image of
+    // a pair is converted by depth and delivered in StampedFrame::depth. Pairs further apart than
+    // maxSkew seconds are dropped.
+    void synchronize(ROSGrabberDepth *depth, std::string depth_scope, double maxSkew, int queueSize);
+    bool isSynchronized();
     void imageCallback(const sensor_msgs::ImageConstPtr& msg);
+    void imagePairCallback(const sensor_msgs::ImageConstPtr& msg, const sensor_msgs::ImageConstPtr& depth_msg);
+    // Takes the newest frame. Must only be called from one thread, returns false if that frame has been taken before.
+    bool getFrame(StampedFrame *frame);
     void getImage(cv::Mat *mat);
+    void getImage(cv::Mat *mat, ros::Time *stamp);
+    // blocks until a frame other than lastFrameNr arrived or timeoutMs passed; returns false on timeout
+    bool waitForFrame(int lastFrameNr, int timeoutMs);
     void setPyr(bool pyr);
-    ros::Time getTimestamp();
     ros::NodeHandle node_handle_;
-    std::string frame_id;
     int getLastFrameNr();
     int pyr;
 private:
-    int frame_nr;
+    typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Image, sensor_msgs::Image> SyncPolicy;
+
+    bool toFrame(const sensor_msgs::ImageConstPtr& msg, StampedFrame *frame);
+    // numbers frame and hands it to the consumer; returns true if the previous frame was dropped without being taken
+    bool publishFrame(StampedFrame *frame);
+    void colorCountCallback(const sensor_msgs::ImageConstPtr& msg);
+    void depthCountCallback(const sensor_msgs::ImageConstPtr& msg);
+
+    // number of the last published frame, counted by the grabber
+    std::atomic<int> frame_nr;
     image_transport::ImageTransport it_;
     image_transport::Subscriber image_sub_;
-    cv::Mat output_frame;
-    cv::Mat source_frame;
-    ros::Time frame_time;
-    std::recursive_mutex mtx;
+    std::string scope;
+    TripleBuffer<StampedFrame> frames;
+
+    // RGB-D synchronization
+    ROSGrabberDepth *sync_depth;
+    image_transport::SubscriberFilter color_filter;
+    image_transport::SubscriberFilter depth_filter;
+    message_filters::Synchronizer<SyncPolicy> *sync;
+    // statistics; the colour and depth messages may be counted by different spinner threads
+    std::atomic<unsigned int> colorReceived;
+    std::atomic<unsigned int> depthReceived;
+    unsigned int pairsReceived;
+    unsigned int pairsDropped;
+    double skewSum;
+    double skewMax;
+    // only used to wait for frames, the frames themselves are passed lock-free
+    std::mutex mtx;
+    std::condition_variable frameArrived;
 };
 
@@ -51,10 +51,14 @@ the use of this software, even if advised of the possibility of such damage.
 using namespace cv;
 using namespace std;
 
-ROSGrabberDepth::ROSGrabberDepth(std::string i_scope) : it_(node_handle_) {
-    image_sub_ = it_.subscribe(i_scope+"/image_raw", 1, &ROSGrabberDepth::imageCallback, this);
+ROSGrabberDepth::ROSGrabberDepth(std::string i_scope, const ros::NodeHandle &node_handle, bool subscribeImage) : node_handle_(node_handle), it_(node_handle_) {
+    if (subscribeImage) {
+        image_sub_ = it_.subscribe(i_scope+"/image_raw", 1, &ROSGrabberDepth::imageCallback, this);
+    }
     info_depth_sub = node_handle_.subscribe(i_scope+"/camera_info", 1, &ROSGrabberDepth::depthInfoCallback, this);
     listener = new tf::TransformListener();
+    target_frame = "map";
+    has_camera_transform = false;
     frame_nr = -1;
     pyr = 0;
     ROS_DEBUG(">>> ROS grabber depth init done");
@@ -64,46 +68,64 @@ ROSGrabberDepth::ROSGrabberDepth(std::string i_scope) : it_(node_handle_) {
 ROSGrabberDepth::~ROSGrabberDepth() { }
 
 void ROSGrabberDepth::imageCallback(const sensor_msgs::ImageConstPtr &msg) {
-    cv_bridge::CvImagePtr cv_ptr;
+    StampedFrame &frame = frames.writeBuffer();
+    if (toFrame(msg, &frame)) {
+        // header.seq is not set for intra-process messages, so the frames are numbered here
+        frame.seq = frame_nr + 1;
+        frames.publish();
+        frame_nr = frame.seq;
+    }
+}
+
+bool ROSGrabberDepth::toFrame(const sensor_msgs::ImageConstPtr &msg, StampedFrame *frame) {
+    cv_bridge::CvImageConstPtr cv_ptr;
     try {
         if (msg->encoding == "16UC1") {
-           cv_ptr = cv_bridge::toCvCopy(msg, sensor_msgs::image_encodings::TYPE_16UC1);
+           cv_ptr = cv_bridge::toCvShare(msg, sensor_msgs::image_encodings::TYPE_16UC1);
         } else if (msg->encoding == "32FC1") {
-           cv_ptr = cv_bridge::toCvCopy(msg, sensor_msgs::image_encodings::TYPE_32FC1);
+           cv_ptr = cv_bridge::toCvShare(msg, sensor_msgs::image_encodings::TYPE_32FC1);
         } else {
           ROS_ERROR(">>> Unknown image encoding %s", msg->encoding.c_str());
-          return;
+          return false;
         }
     } catch (cv_bridge::Exception& e) {
       ROS_ERROR(">>> CV_BRIDGE exception: %s", e.what());
-      return;
+      return false;
     }
 
-    mtx.lock();
-    frame_time = msg->header.stamp;
-    frame_nr = (int)msg->header.seq;
-    frame_id = msg->header.frame_id;
-    source_frame = cv_ptr->image;
+    frame->stamp = msg->header.stamp;
+    frame->frame_id = msg->header.frame_id;
+    frame->source = cv_ptr;
     if (pyr > 0) {
-        cv::pyrUp(source_frame, output_frame, cv::Size(source_frame.cols, source_frame.rows));
+        // a new buffer, the previous image of this slot may still be in use by a consumer
+        frame->image = cv::Mat();
+        cv::pyrUp(cv_ptr->image, frame->image, cv::Size(cv_ptr->image.cols, cv_ptr->image.rows));
     } else {
-        output_frame = source_frame;
+        frame->image = cv_ptr->image;
     }
-    mtx.unlock();
+    return true;
+}
+
+bool ROSGrabberDepth::getFrame(StampedFrame *frame) {
+    bool isNew = frames.update();
+    *frame = frames.readBuffer();
+    setFrame(frame->frame_id, frame->stamp);
+    return isNew;
 }
 
 void ROSGrabberDepth::getImage(cv::Mat *mat) {
-    mtx.lock();
-    *mat = output_frame;
-    mtx.unlock();
+    StampedFrame frame;
+    getFrame(&frame);
+    *mat = frame.image;
 }
 
-void ROSGrabberDepth::setPyr(bool _pyr) {
-    pyr = _pyr;
+void ROSGrabberDepth::setFrame(const std::string &id, const ros::Time &stamp) {
+    frame_id = id;
+    frame_stamp = stamp;
 }
 
-ros::Time ROSGrabberDepth::getTimestamp() {
-    return frame_time;
+void ROSGrabberDepth::setPyr(bool _pyr) {
+    pyr = _pyr;
 }
 
 int ROSGrabberDepth::getLastFrameNr() {
@@ -139,7 +161,7 @@ geometry_msgs::PoseStamped ROSGrabberDepth::getDetectionPose(const cv::Mat & dep
     if (isfinite(center3D.val[0]) && isfinite(center3D.val[1]) && isfinite(center3D.val[2])) {
         geometry_msgs::PoseStamped camera_pose;
         camera_pose.header.frame_id = frame_id;
-        camera_pose.header.stamp = ros::Time::now();
+        camera_pose.header.stamp = frame_stamp;
         camera_pose.pose.position.x = center3D.val[0];
         camera_pose.pose.position.y = center3D.val[1];
         camera_pose.pose.position.z = center3D.val[2];
@@ -148,14 +170,20 @@ geometry_msgs::PoseStamped ROSGrabberDepth::getDetectionPose(const cv::Mat & dep
         camera_pose.pose.orientation.z = 0.0;
         camera_pose.pose.orientation.w = 1.0;
 
-        base_link_pose.header.frame_id = "map";
-
-        try{
-            //ROS_DEBUG(">>> Transforming received position into MAP coordinate system.");
-            listener->waitForTransform(camera_pose.header.frame_id, base_link_pose.header.frame_id, camera_pose.header.stamp, ros::Duration(5.0));
-            listener->transformPose(base_link_pose.header.frame_id, ros::Time(0), camera_pose, camera_pose.header.frame_id, base_link_pose);
-        } catch(tf::TransformException ex) {
-            ROS_ERROR(">>> Failed transform: %s", ex.what());
+        if (lookupCameraTransform()) {
+            tf::Vector3 position = camera_transform * tf::Vector3(center3D.val[0], center3D.val[1], center3D.val[2]);
+            tf::Quaternion orientation = camera_transform.getRotation();
+            base_link_pose.header.frame_id = target_frame;
+            // stamped with the image the position was measured in, not with the transform
+            base_link_pose.header.stamp = frame_stamp;
+            base_link_pose.pose.position.x = position.x();
+            base_link_pose.pose.position.y = position.y();
+            base_link_pose.pose.position.z = position.z();
+            base_link_pose.pose.orientation.x = orientation.x();
+            base_link_pose.pose.orientation.y = orientation.y();
+            base_link_pose.pose.orientation.z = orientation.z();
+            base_link_pose.pose.orientation.w = orientation.w();
+        } else {
             base_link_pose = camera_pose;
         }
     }
@@ -164,6 +192,38 @@ geometry_msgs::PoseStamped ROSGrabberDepth::getDetectionPose(const cv::Mat & dep
 
 }
 
+bool ROSGrabberDepth::lookupCameraTransform() {
+    // once per frame, all poses of a frame share the transform
+    if (has_camera_transform && transform_frame_id == frame_id && transform_frame_stamp == frame_stamp) {
+        return true;
+    }
+
+    try {
+        // the transform at the time of the frame if tf already has it, otherwise the latest one
+        if (listener->canTransform(target_frame, frame_id, frame_stamp)) {
+            listener->lookupTransform(target_frame, frame_id, frame_stamp, camera_transform);
+            has_camera_transform = true;
+        } else if (listener->canTransform(target_frame, frame_id, ros::Time(0))) {
+            listener->lookupTransform(target_frame, frame_id, ros::Time(0), camera_transform);
+            has_camera_transform = true;
+        } else if (has_camera_transform && camera_transform.child_frame_id_ == frame_id) {
+            ROS_WARN_THROTTLE(5, ">>> No transform from %s to %s, reusing the last one", frame_id.c_str(), target_frame.c_str());
+        } else {
+            ROS_WARN_THROTTLE(5, ">>> No transform from %s to %s, publishing in the camera frame", frame_id.c_str(), target_frame.c_str());
+            return false;
+        }
+    } catch (tf::TransformException &ex) {
+        ROS_ERROR_THROTTLE(5, ">>> Failed transform: %s", ex.what());
+        if (!has_camera_transform || camera_transform.child_frame_id_ != frame_id) {
+            return false;
+        }
+    }
+
+    transform_frame_id = frame_id;
+    transform_frame_stamp = frame_stamp;
+    return true;
+}
+
 void ROSGrabberDepth::createVisualisation(geometry_msgs::Pose& pose, ros::Publisher &pub) {
     //ROS_DEBUG(">>> Creating markers");
     visualization_msgs::MarkerArray marker_array;
@@ -172,11 +232,65 @@ void ROSGrabberDepth::createVisualisation(geometry_msgs::Pose& pose, ros::Publis
     pub.publish(marker_array);
 }
 
+// upper bound of the depth values looked at per box
+static const int MAX_DEPTH_SAMPLES = 256;
+
+static inline bool isValidDepth(uint16_t d) {
+    return d != 0;
+}
+
+static inline bool isValidDepth(float d) {
+    // false for NaN as well
+    return d > 0.0f && d < std::numeric_limits<float>::infinity();
+}
+
+// Collects the valid depths on a regular grid over the inner half of bb, the background around a
+// person is mostly outside of it. The grid is at most MAX_DEPTH_SAMPLES points, so the cost does
+// not depend on the box size. This is a plain scalar loop without SIMD; invalid values are dropped
+// with a branchless compaction. Returns the number of values written to samples.
+template <class T>
+static int sampleDepth(const cv::Mat &depthImage, const cv::Rect &bb, float *samples) {
+    cv::Rect inner(bb.x + bb.width / 4, bb.y + bb.height / 4, std::max(1, bb.width / 2), std::max(1, bb.height / 2));
+    inner &= cv::Rect(0, 0, depthImage.cols, depthImage.rows);
+
+    if (inner.area() <= 0)
+        return 0;
+
+    int step = std::max(1, (int)std::sqrt((double)inner.area() / MAX_DEPTH_SAMPLES));
+
+    while (((inner.width + step - 1) / step) * ((inner.height + step - 1) / step) > MAX_DEPTH_SAMPLES)
+        step++;
+
+    int numSamples = 0;
+
+    for (int y = inner.y; y < inner.br().y; y += step) {
+        const T *row = depthImage.ptr<T>(y);
+
+        for (int x = inner.x; x < inner.br().x; x += step) {
+            // branchless compaction; an invalid value is overwritten by the next one
+            T d = row[x];
+            samples[numSamples] = (float)d;
+            numSamples += isValidDepth(d);
+        }
+    }
+
+    return numSamples;
+}
+
 cv::Vec3f ROSGrabberDepth::getDepth(const cv::Mat & depthImage, cv::Rect* bb) {
 
     double x = (bb->br().x - bb->size().width/2) + 0.5f;
     double y = (bb->br().y - bb->size().height/2) + 0.5f;
- 
+
+    // a tracked box may leave the image completely, which is not an error
+    if ((*bb & cv::Rect(0, 0, depthImage.cols, depthImage.rows)).area() <= 0) {
+        ROS_DEBUG(">>> Box is outside of the depth image");
+        return Vec3f(
+                numeric_limits<float>::quiet_NaN(),
+                numeric_limits<float>::quiet_NaN(),
+                numeric_limits<float>::quiet_NaN());
+    }
+
     if(!(x >=0 && x<depthImage.cols && y >=0 && y<depthImage.rows))
 	{
 		ROS_ERROR(">>> Point must be inside the image!");
@@ -204,57 +318,21 @@ cv::Vec3f ROSGrabberDepth::getDepth(const cv::Mat & depthImage, cv::Rect* bb) {
     float depth;
     bool isValid;
 
-    if(is16BitType) {
-        // Sample fore depth points to the right, left, top and down
-        std::vector<float> valueList;
-        for (int i=0; i<5; i++) {
-            if((float)depthImage.at<uint16_t>(y,x+i) != 0){
-                valueList.push_back((float)depthImage.at<uint16_t>(y,x+i));
-            }
-            if((float)depthImage.at<uint16_t>(y,x-i) != 0){
-                valueList.push_back((float)depthImage.at<uint16_t>(y,x-i));
-            }
-            if((float)depthImage.at<uint16_t>(y+i,x) != 0){
-                valueList.push_back((float)depthImage.at<uint16_t>(y+i,x));
-            }
-            if((float)depthImage.at<uint16_t>(y-i,x) != 0){
-                valueList.push_back((float)depthImage.at<uint16_t>(y-i,x));
-            }
-        }
-
-        ROS_DEBUG("Sampled %d values", valueList.size());
-
-        if(!valueList.empty()) {
-            std::sort (valueList.begin(), valueList.end());
-            float median = valueList[(int)(valueList.size()/2)];
-            depth = median;
-            ROS_DEBUG("Median of depth: %f", depth);
-            isValid = true;
-        } else {
-            depth = 0;
-            isValid = false;
-        }
-
-    } else {
-        float depth_samples[21];
-
-        // Sample fore depth points to the right, left, top and down
-        for (int i=0; i<5; i++) {
-            depth_samples[i] = depthImage.at<float>(y,x+i);
-            depth_samples[i+5] = depthImage.at<float>(y,x-i);
-            depth_samples[i+10] = depthImage.at<float>(y+i,x);
-            depth_samples[i+15] = depthImage.at<float>(y-i,x);
-        }
-
-        depth_samples[20] = depthImage.at<float>(y,x);
+    float samples[MAX_DEPTH_SAMPLES];
+    int numSamples = is16BitType ? sampleDepth<uint16_t>(depthImage, *bb, samples)
+                                 : sampleDepth<float>(depthImage, *bb, samples);
 
-        int arr_size = sizeof(depth_samples)/sizeof(float);
-        std::sort(&depth_samples[0], &depth_samples[arr_size]);
-        float median = arr_size % 2 ? depth_samples[arr_size/2] : (depth_samples[arr_size/2-1] + depth_samples[arr_size/2]) / 2;
+    ROS_DEBUG("Sampled %d values", numSamples);
 
-        depth = median;
+    if (numSamples > 0) {
+        float *median = samples + numSamples / 2;
+        std::nth_element(samples, median, samples + numSamples);
+        depth = *median;
         ROS_DEBUG("Median of depth: %f", depth);
-        isValid = std::isfinite(depth);
+        isValid = true;
+    } else {
+        depth = 0;
+        isValid = false;
     }
 
 	// Check for invalid measurements
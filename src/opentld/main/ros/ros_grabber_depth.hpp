@@ -62,12 +62,18 @@ the use of this software, even if advised of the possibility of such damage.
 //TF
 #include <tf/transform_listener.h>
 
+// SELF
+#include "stamped_frame.hpp"
+
 // STD
 #include <mutex>
+#include <atomic>
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 
 // CV
 #include <opencv2/imgproc/imgproc.hpp>
@@ -79,29 +85,44 @@ the use of this software, even if advised of the possibility of such damage.
 class ROSGrabberDepth {
 
 public:
-    ROSGrabberDepth(std::string i_scope);
+    // subscribeImage is false if the depth images are delivered by a synchronized ROSGrabber
+    ROSGrabberDepth(std::string i_scope, const ros::NodeHandle &node_handle = ros::NodeHandle(), bool subscribeImage = true);
     ~ROSGrabberDepth();
     cv::Vec3f getDepth(const cv::Mat & depthImage, cv::Rect* bb);
     geometry_msgs::PoseStamped getDetectionPose(const cv::Mat & depthImage, cv::Rect* bb);
     void depthInfoCallback(const sensor_msgs::CameraInfoConstPtr& cameraInfoMsg);
     void imageCallback(const sensor_msgs::ImageConstPtr& msg);
+    // converts msg without copying its data; returns false for unsupported encodings
+    bool toFrame(const sensor_msgs::ImageConstPtr& msg, StampedFrame *frame);
+    // frame id and stamp of the depth image passed to the next getDetectionPose calls, set by getFrame
+    void setFrame(const std::string &id, const ros::Time &stamp);
+    // Takes the newest depth frame. Must only be called from the thread that also calls getDetectionPose.
+    bool getFrame(StampedFrame *frame);
     void getImage(cv::Mat *mat);
     void setPyr(bool pyr);
-    ros::Time getTimestamp();
     ros::NodeHandle node_handle_;
-    std::string frame_id;
     int getLastFrameNr();
     int pyr;
     void createVisualisation(geometry_msgs::Pose& pose, ros::Publisher& pub);
 private:
-    int frame_nr;
+    // number of the last published frame, counted by the grabber
+    std::atomic<int> frame_nr;
     image_transport::ImageTransport it_;
     image_transport::Subscriber image_sub_;
     ros::Subscriber info_depth_sub;
-    cv::Mat output_frame;
-    cv::Mat source_frame;
-    ros::Time frame_time;
-    std::recursive_mutex mtx;
+    TripleBuffer<StampedFrame> frames;
+    // frame_id and stamp of the frame last taken by the consumer, used for the detection poses
+    std::string frame_id;
+    ros::Time frame_stamp;
+
+    // Transform from the camera into target_frame. Looked up without waiting, so tracking never
+    // blocks on tf; the last transform found is reused while tf has none.
+    bool lookupCameraTransform();
+    std::string target_frame;
+    tf::StampedTransform camera_transform;
+    bool has_camera_transform;
+    std::string transform_frame_id;
+    ros::Time transform_frame_stamp;
 
     //DepthImage stuff
     float depth_fx;
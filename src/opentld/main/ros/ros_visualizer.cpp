@@ -0,0 +1,136 @@
+/*
+
+Author: Florian Lier [flier AT techfak.uni-bielefeld DOT de]
+
+By downloading, copying, installing or using the software you agree to this license.
+If you do not agree to this license, do not download, install, copy or use the software.
+
+                          License Agreement
+               For Open Source Computer Vision Library
+                       (3-clause BSD License)
+
+Copyright (C) 2000-2016, Intel Corporation, all rights reserved.
+Copyright (C) 2009-2011, Willow Garage Inc., all rights reserved.
+Copyright (C) 2009-2016, NVIDIA Corporation, all rights reserved.
+Copyright (C) 2010-2013, Advanced Micro Devices, Inc., all rights reserved.
+Copyright (C) 2015-2016, OpenCV Foundation, all rights reserved.
+Copyright (C) 2015-2016, Itseez Inc., all rights reserved.
+Third party copyrights are property of their respective owners.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the names of the copyright holders nor the names of the contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+This software is provided by the copyright holders and contributors "as is" and
+any express or implied warranties, including, but not limited to, the implied
+warranties of merchantability and fitness for a particular purpose are disclaimed.
+In no event shall copyright holders or contributors be liable for any direct,
+indirect, incidental, special, exemplary, or consequential damages
+(including, but not limited to, procurement of substitute goods or services;
+loss of use, data, or profits; or business interruption) however caused
+and on any theory of liability, whether in contract, strict liability,
+or tort (including negligence or otherwise) arising in any way out of
+the use of this software, even if advised of the possibility of such damage.
+
+*/
+
+
+// SELF
+#include "ros_visualizer.hpp"
+
+ROSVisualizer::ROSVisualizer(ros::NodeHandle &node_handle, ROSGrabberDepth *_depth, double rate) :
+    it_(node_handle), depth(_depth), hasPending(false), stopping(false) {
+    pub_image = it_.advertise("cftld/detection", 1);
+    pub_marker_array = node_handle.advertise<visualization_msgs::MarkerArray>("/cftld/marker_array", 1);
+    if (rate > 0) {
+        period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    } else {
+        period = std::chrono::steady_clock::duration::max();
+    }
+    lastSubmit = std::chrono::steady_clock::time_point();
+    worker = std::thread(&ROSVisualizer::run, this);
+}
+
+ROSVisualizer::~ROSVisualizer() {
+    mtx.lock();
+    stopping = true;
+    mtx.unlock();
+    frameSubmitted.notify_one();
+    worker.join();
+}
+
+bool ROSVisualizer::wantsFrame() {
+    if (period == std::chrono::steady_clock::duration::max()) {
+        return false;
+    }
+    if (pub_image.getNumSubscribers() == 0 && pub_marker_array.getNumSubscribers() == 0) {
+        return false;
+    }
+    return std::chrono::steady_clock::now() - lastSubmit >= period;
+}
+
+void ROSVisualizer::submit(VisualizationFrame &frame) {
+    lastSubmit = std::chrono::steady_clock::now();
+    mtx.lock();
+    pending = std::move(frame);
+    hasPending = true;
+    mtx.unlock();
+    frameSubmitted.notify_one();
+}
+
+void ROSVisualizer::render(const VisualizationFrame &frame, cv::Mat *out) {
+    frame.image.copyTo(*out);
+
+    for (size_t i = 0; i < frame.boxes.size(); i++) {
+        const VisualizationBox &box = frame.boxes[i];
+        cv::rectangle(*out, box.box.tl(), box.box.br(), box.color, 2, 8, 0);
+        if (!box.label.empty()) {
+            cv::putText(*out, box.label, box.box.tl() + cv::Point(2, 12), cv::FONT_HERSHEY_SIMPLEX, 0.4, box.color, 1, 8);
+        }
+    }
+
+    cv::putText(*out, frame.info, cv::Point(15, 15), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(255, 144, 30, 0), 1, 8);
+}
+
+void ROSVisualizer::run() {
+    VisualizationFrame frame;
+    cv::Mat overlay;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            frameSubmitted.wait(lock, [this] { return hasPending || stopping; });
+            if (stopping) {
+                return;
+            }
+            frame = std::move(pending);
+            hasPending = false;
+        }
+
+        if (pub_marker_array.getNumSubscribers() > 0) {
+            for (size_t i = 0; i < frame.markers.size(); i++) {
+                depth->createVisualisation(frame.markers[i], pub_marker_array);
+            }
+        }
+
+        if (pub_image.getNumSubscribers() > 0) {
+            render(frame, &overlay);
+            std_msgs::Header header;
+            header.stamp = frame.stamp;
+            pub_image.publish(cv_bridge::CvImage(header, "bgr8", overlay).toImageMsg());
+        }
+
+        // drop the reference to the ROS message before waiting
+        frame = VisualizationFrame();
+    }
+}
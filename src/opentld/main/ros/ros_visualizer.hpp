@@ -0,0 +1,119 @@
+/*
+
+Author: Florian Lier [flier AT techfak.uni-bielefeld DOT de]
+
+By downloading, copying, installing or using the software you agree to this license.
+If you do not agree to this license, do not download, install, copy or use the software.
+
+                          License Agreement
+               For Open Source Computer Vision Library
+                       (3-clause BSD License)
+
+Copyright (C) 2000-2016, Intel Corporation, all rights reserved.
+Copyright (C) 2009-2011, Willow Garage Inc., all rights reserved.
+Copyright (C) 2009-2016, NVIDIA Corporation, all rights reserved.
+Copyright (C) 2010-2013, Advanced Micro Devices, Inc., all rights reserved.
+Copyright (C) 2015-2016, OpenCV Foundation, all rights reserved.
+Copyright (C) 2015-2016, Itseez Inc., all rights reserved.
+Third party copyrights are property of their respective owners.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the names of the copyright holders nor the names of the contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+This software is provided by the copyright holders and contributors "as is" and
+any express or implied warranties, including, but not limited to, the implied
+warranties of merchantability and fitness for a particular purpose are disclaimed.
+In no event shall copyright holders or contributors be liable for any direct,
+indirect, incidental, special, exemplary, or consequential damages
+(including, but not limited to, procurement of substitute goods or services;
+loss of use, data, or profits; or business interruption) however caused
+and on any theory of liability, whether in contract, strict liability,
+or tort (including negligence or otherwise) arising in any way out of
+the use of this software, even if advised of the possibility of such damage.
+
+*/
+
+
+#pragma once
+
+// ROS
+#include <ros/ros.h>
+#include <cv_bridge/cv_bridge.h>
+#include <image_transport/image_transport.h>
+#include <geometry_msgs/Pose.h>
+#include <visualization_msgs/MarkerArray.h>
+
+// SELF
+#include "ros_grabber_depth.hpp"
+
+// STD
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// CV
+#include <opencv2/imgproc/imgproc.hpp>
+
+struct VisualizationBox {
+    cv::Rect box;
+    cv::Scalar color;
+    std::string label;
+};
+
+// Everything needed to draw the debug image of one frame.
+struct VisualizationFrame {
+    // read only, may point into a ROS message that source keeps alive
+    cv::Mat image;
+    cv_bridge::CvImageConstPtr source;
+    ros::Time stamp;
+    std::string info;
+    std::vector<VisualizationBox> boxes;
+    // poses in the map frame that get a person marker
+    std::vector<geometry_msgs::Pose> markers;
+};
+
+// Renders and publishes the debug image and markers on its own thread, at most rate times per
+// second and only while somebody is subscribed. Frames that arrive while the previous one is
+// still being rendered replace it.
+class ROSVisualizer {
+
+public:
+    ROSVisualizer(ros::NodeHandle &node_handle, ROSGrabberDepth *depth, double rate);
+    ~ROSVisualizer();
+    // cheap check for the tracking thread whether a frame submitted now would be used
+    bool wantsFrame();
+    // never blocks; frame is moved from
+    void submit(VisualizationFrame &frame);
+    // draws the boxes and info text of frame into a copy of its image
+    static void render(const VisualizationFrame &frame, cv::Mat *out);
+private:
+    void run();
+
+    image_transport::ImageTransport it_;
+    image_transport::Publisher pub_image;
+    ros::Publisher pub_marker_array;
+    ROSGrabberDepth *depth;
+    std::chrono::steady_clock::duration period;
+    std::chrono::steady_clock::time_point lastSubmit;
+
+    std::mutex mtx;
+    std::condition_variable frameSubmitted;
+    VisualizationFrame pending;
+    bool hasPending;
+    bool stopping;
+    std::thread worker;
+};
@@ -0,0 +1,124 @@
+/*
+
+Author: Florian Lier [flier AT techfak.uni-bielefeld DOT de]
+
+By downloading, copying, installing or using the software you agree to this license.
+If you do not agree to this license, do not download, install, copy or use the software.
+
+                          License Agreement
+               For Open Source Computer Vision Library
+                       (3-clause BSD License)
+
+Copyright (C) 2000-2016, Intel Corporation, all rights reserved.
+Copyright (C) 2009-2011, Willow Garage Inc., all rights reserved.
+Copyright (C) 2009-2016, NVIDIA Corporation, all rights reserved.
+Copyright (C) 2010-2013, Advanced Micro Devices, Inc., all rights reserved.
+Copyright (C) 2015-2016, OpenCV Foundation, all rights reserved.
+Copyright (C) 2015-2016, Itseez Inc., all rights reserved.
+Third party copyrights are property of their respective owners.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the names of the copyright holders nor the names of the contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+This software is provided by the copyright holders and contributors "as is" and
+any express or implied warranties, including, but not limited to, the implied
+warranties of merchantability and fitness for a particular purpose are disclaimed.
+In no event shall copyright holders or contributors be liable for any direct,
+indirect, incidental, special, exemplary, or consequential damages
+(including, but not limited to, procurement of substitute goods or services;
+loss of use, data, or profits; or business interruption) however caused
+and on any theory of liability, whether in contract, strict liability,
+or tort (including negligence or otherwise) arising in any way out of
+the use of this software, even if advised of the possibility of such damage.
+
+*/
+
+
+#pragma once
+
+// ROS
+#include <ros/ros.h>
+#include <cv_bridge/cv_bridge.h>
+
+// STD
+#include <atomic>
+#include <string>
+
+// CV
+#include <opencv2/core/core.hpp>
+
+// A received image together with its header. image may point into the
+// ROS message (see source), so consumers must treat it as read only and
+// draw into their own copy.
+struct StampedFrame {
+    cv::Mat image;
+    int seq = -1;
+    ros::Time stamp;
+    std::string frame_id;
+    // keeps the message data alive that image refers to
+    cv_bridge::CvImageConstPtr source;
+    // depth image paired with image, only set if the RGB-D streams are synchronized
+    cv::Mat depth;
+    ros::Time depth_stamp;
+    std::string depth_frame_id;
+    cv_bridge::CvImageConstPtr depth_source;
+};
+
+// Lock-free triple buffer for exactly one producer and one consumer thread.
+// The producer fills writeBuffer() and publishes it, the consumer takes the
+// newest published buffer with update() and reads it until the next update().
+template <class T>
+class TripleBuffer {
+
+public:
+    TripleBuffer() : middle(1), writeIdx(0), readIdx(2) {}
+
+    // producer
+    T& writeBuffer() {
+        return buffers[writeIdx];
+    }
+
+    // returns true if the previously published buffer was never read and has been dropped
+    bool publish() {
+        int previous = middle.exchange(writeIdx | FRESH, std::memory_order_acq_rel);
+        writeIdx = previous & INDEX;
+        return (previous & FRESH) != 0;
+    }
+
+    // consumer; returns false if nothing new has been published since the last call
+    bool update() {
+        if (!hasNewData()) {
+            return false;
+        }
+        int previous = middle.exchange(readIdx, std::memory_order_acq_rel);
+        readIdx = previous & INDEX;
+        return true;
+    }
+
+    const T& readBuffer() const {
+        return buffers[readIdx];
+    }
+
+    bool hasNewData() const {
+        return (middle.load(std::memory_order_acquire) & FRESH) != 0;
+    }
+
+private:
+    enum { INDEX = 3, FRESH = 4 };
+    T buffers[3];
+    // index of the buffer between producer and consumer, FRESH if it has not been read yet
+    std::atomic<int> middle;
+    int writeIdx;
+    int readIdx;
+};